@@ -4,6 +4,16 @@
 #include <stdbool.h>
 #include <math.h>
 #include <ctype.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "lib/tiles.h"
+#include "lib/savefile.h"
 
 /* Exit status codes */
 #define ERROR_INCORRECT_ARGS 1
@@ -13,130 +23,811 @@
 #define ERROR_INVALID_DIMENSIONS 5
 #define ERROR_SAVEFILE_UNREADABLE 6
 #define ERROR_SAVEFILE_INVALID 7
+#define ERROR_MOVELOG_UNREADABLE 8
+#define ERROR_MOVELOG_INVALID 9
 #define ERROR_EOF 10
-
-#define TILE_SIZE 5
-#define MAX_BOARD_SIZE 999
-
-#define EMPTY_TILE_CELL ','
-#define OCCUPIED_TILE_CELL '!'
-#define EMPTY_GRID_CELL '.'
+#define ERROR_BOOK_INVALID 11
 
 /* Player types */
 #define PLAYER_TYPE_HUMAN 0
 #define PLAYER_TYPE_AUTO_ONE 1
 #define PLAYER_TYPE_AUTO_TWO 2
+#define PLAYER_TYPE_AUTO_MOBILITY 3
+#define PLAYER_TYPE_RANDOM 4
+#define PLAYER_TYPE_EPSILON 5
+
+/* Chance an epsilon-greedy player moves randomly, if not given */
+#define DEFAULT_EPSILON 0.1
+
+/* Step between states of the random number generator (splitmix64's) */
+#define RANDOM_STATE_STEP 0x9E3779B97F4A7C15ULL
+
+/* How the grid is printed after each move */
+#define RENDER_FULL 0
+#define RENDER_DIFF 1
+#define RENDER_QUIET 2
+#define RENDER_NONE 3
+
+/* Number of game length buckets kept for each starting tile */
+#define STATS_LENGTH_BUCKETS 64
+
+/* Scripted input reading and reporting */
+#define SCRIPT_BUFFER_SIZE 65536
+#define SCRIPT_REPORT_LINES 10
+
+/* Kinds of line in a move script */
+#define SCRIPT_MOVE 0
+#define SCRIPT_SAVE 1
+#define SCRIPT_INVALID 2
+
+/* Number of positions auto players search between checks of the clock */
+#define DEADLINE_CHECK_NODES 1024
+
+/* Number of legal placements the mobility player compares each move */
+#define MOBILITY_CANDIDATES 256
 
 #define PLAYER_ONE 0
 #define PLAYER_TWO 1
 
+/* Number of grid rows in each copy on write page */
+#define GRID_PAGE_ROWS 16
+/* Occupied cells kept around each side of a rotated board view */
+#define VIEW_PADDING 4
+
+/* Scan orders of a parallel first-fit search */
+#define SEARCH_ROTATIONS_INNER 0
+#define SEARCH_ROTATIONS_OUTER 1
+/* Results of a parallel first-fit search */
+#define SEARCH_FOUND 0
+#define SEARCH_NONE 1
+#define SEARCH_TIMED_OUT 2
+/* Rows of positions search threads take at a time */
+#define SEARCH_CHUNK_ROWS 4
+/* Smallest grid (in cells) searches are shared with the search pool for */
+#define SEARCH_POOL_MIN_CELLS 10000
+
 #define INITIAL_BUFFER 100
 #define MAX_VALID_LINE_LENGTH 70
 
 /* Macro to give player symbol from currentPlayer int */
 #define PLAYER_SYMBOL(x) ((x) == 0 ? '*' : '#')
 
+/* Move log format. See open_move_log for layout */
+#define MOVELOG_MAGIC "FZML"
+#define MOVELOG_VERSION 1
+#define MOVELOG_HEADER_SIZE 20
+#define MOVELOG_RECORD_SIZE 9
+#define MOVELOG_FLAG_BASE_GRID 1
+
+/* Delta savefile journal format. See start_journal for layout */
+#define JOURNAL_MAGIC "FZJL"
+#define JOURNAL_VERSION 2
+#define JOURNAL_HEADER_SIZE 20
+#define JOURNAL_SUFFIX ".journal"
+
+/* Endgame solver limits */
+#define SOLVER_MAX_CELLS 64
+#define SOLVER_DEFAULT_MEMORY 64
+#define SOLVER_REPORT_NODES (1 << 22)
+
+/* Opening book format. See write_opening_book for layout */
+#define BOOK_MAGIC "FZOB"
+#define BOOK_VERSION 1
+#define BOOK_DEFAULT_PLIES 2
+
 /*
  * Stores a previous move made by a player
  *  - row: Row of the centre of tile this move placed 
  *  - column: Column of the centre of tile this move placed 
+ *  - rotation: Degrees the tile was rotated by (0, 90, 180 or 270)
  */
 typedef struct {
     int row;
     int column;
+    int rotation;
 } PreviousMove;
 
+/*
+ * Occupied cells of a rotated tile, for generating legal moves quickly
+ *  - numCells: Number of occupied cells
+ *  - rows, columns: Offset of each occupied cell from the tile's centre
+ *  - top, bottom: Smallest and largest row offset of an occupied cell
+ *  - left, right: Smallest and largest column offset of an occupied cell
+ */
+typedef struct {
+    int numCells;
+    int rows[TILE_SIZE * TILE_SIZE];
+    int columns[TILE_SIZE * TILE_SIZE];
+    int top;
+    int bottom;
+    int left;
+    int right;
+} TileShape;
+
+/*
+ * A single placement read from or written to a move log
+ *  - tile: Index of the tile placed in the tilefile
+ *  - row: Row of the centre of the placed tile
+ *  - column: Column of the centre of the placed tile
+ *  - rotation: Degrees the tile was rotated by (0, 90, 180 or 270)
+ *  - player: Player who made the move (0 for P1, 1 for P2)
+ */
+typedef struct {
+    int tile;
+    int row;
+    int column;
+    int rotation;
+    int player;
+} MoveRecord;
+
+/*
+ * Options given on the command line with a leading "--"
+ *  - moveLogFile: Path to append every placement to, or NULL
+ *  - replayFile: Path of move log to replay, or NULL
+ *  - replayPly: Number of moves to replay (-1 for the whole log)
+ *  - verifyReplay: Whether to check every logged move is legal first
+ *  - deltaSaves: Whether saves write a base snapshot plus a move journal
+ *  - checkpointFile: Path to save to after every move, or NULL
+ *  - solveFile: Savefile to find the game theoretic winner of, or NULL
+ *  - solverMemory: Megabytes the solver's position table may use
+ *  - endgameCells: Mobility players solve exactly once this few cells are
+ *    empty
+ *  - bookFile: Opening book mobility players look moves up in, or NULL
+ *  - makeBookFile: Path to write a generated opening book to, or NULL
+ *  - bookPlies: Number of opening moves to put in a generated book
+ *  - renderMode: RENDER_FULL, RENDER_DIFF or RENDER_QUIET
+ *  - batchGames: Number of auto games to simulate, or 0 to play normally
+ *  - batchThreads: Number of threads simulating batch games
+ *  - statsFile: Path to write batch game analytics to as CSV, or NULL
+ *  - seed: Seed for random players' number generators
+ *  - epsilon: Chance an epsilon-greedy player moves randomly
+ *  - moveBudget: Milliseconds auto players may take per move, or 0
+ *  - scripted: Whether human players' moves are read as a script
+ *  - boardViews: Whether auto players check placements with board views
+ *  - searchThreads: Number of threads large first-fit searches are shared
+ *    between
+ */
+typedef struct {
+    char* moveLogFile;
+    char* replayFile;
+    int replayPly;
+    bool verifyReplay;
+    bool deltaSaves;
+    char* checkpointFile;
+    char* solveFile;
+    int solverMemory;
+    int endgameCells;
+    char* bookFile;
+    char* makeBookFile;
+    int bookPlies;
+    int renderMode;
+    int batchGames;
+    int batchThreads;
+    char* statsFile;
+    int seed;
+    double epsilon;
+    int moveBudget;
+    bool scripted;
+    bool boardViews;
+    int searchThreads;
+} Options;
+
+/*
+ * Reads human players' moves from stdin in large blocks, without prompts.
+ * Lines that aren't legal moves are counted and reported together.
+ *  - buffer: Input read but not yet parsed
+ *  - start: Index of first unparsed byte in buffer
+ *  - end: Number of bytes in buffer
+ *  - endOfInput: Whether stdin has been read to the end
+ *  - skipping: Whether the rest of an overlong line is being skipped
+ *  - lineNum: Number of lines parsed so far
+ *  - numInvalid: Number of lines that weren't legal moves or saves
+ *  - invalidLines: Line numbers of the first SCRIPT_REPORT_LINES of them
+ */
+typedef struct {
+    char buffer[SCRIPT_BUFFER_SIZE];
+    long start;
+    long end;
+    bool endOfInput;
+    bool skipping;
+    long lineNum;
+    long numInvalid;
+    long invalidLines[SCRIPT_REPORT_LINES];
+} Script;
+
+/*
+ * A line of a move script, once tokenised
+ *  - type: SCRIPT_MOVE, SCRIPT_SAVE or SCRIPT_INVALID
+ *  - row, column, rotation: Move given, for SCRIPT_MOVE lines
+ *  - savefile: Null terminated savefile path, for SCRIPT_SAVE lines
+ */
+typedef struct {
+    int type;
+    int row;
+    int column;
+    int rotation;
+    char* savefile;
+} ScriptLine;
+
+/*
+ * Analytics gathered over a batch of games. Each thread keeps its own and
+ * they are added together once every thread has finished.
+ *  - height, width: Size of the grid games are played on
+ *  - numTiles: Number of tiles in the tile cycle
+ *  - cellHits: Times each player has covered each cell, indexed by
+ *    player * height * width + row * width + column
+ *  - rotations: Times each player has placed a tile at each rotation
+ *  - lengths: Number of games by starting tile and length bucket, indexed
+ *    by tile * STATS_LENGTH_BUCKETS + bucket
+ *  - bucketSize: Number of game lengths (in moves) in each bucket
+ */
+typedef struct {
+    int height;
+    int width;
+    int numTiles;
+    long* cellHits;
+    long rotations[2][4];
+    long* lengths;
+    int bucketSize;
+} Stats;
+
+/*
+ * Reusable buffer output is built in before being written in one go
+ *  - data: Buffer contents
+ *  - size: Number of bytes used in data
+ *  - capacity: Number of bytes allocated for data
+ */
+typedef struct {
+    char* data;
+    long size;
+    long capacity;
+} Frame;
+
+/*
+ * A placement of a tile on a small (at most SOLVER_MAX_CELLS cell) board
+ *  - mask: Bitboard of the cells covered, bit (row * width + column)
+ *  - row, column: Centre of the placed tile
+ *  - rotation: Degrees the tile was rotated by
+ */
+typedef struct {
+    unsigned long long mask;
+    int row;
+    int column;
+    int rotation;
+} Placement;
+
+/*
+ * Entry in the solver's position table
+ *  - occupied: Bitboard of occupied cells
+ *  - tile: Tile to be placed next, plus one (0 marks an unused entry)
+ *  - moverWins: Whether the player to move wins from this position
+ */
+typedef struct {
+    unsigned long long occupied;
+    unsigned int tile;
+    bool moverWins;
+} SolverEntry;
+
+/*
+ * Exact solver for games on small boards
+ *  - height, width: Dimensions of the board
+ *  - numTiles: Number of tiles in the tile cycle
+ *  - numPlacements: Number of distinct placements of each tile
+ *  - placements: Distinct placements of each tile (by covered cells)
+ *  - table: Bounded table of solved positions, always replaced on collision
+ *  - tableMask: Number of table entries minus one (a power of two)
+ *  - tableUsed: Number of table entries in use
+ *  - nodes: Positions searched so far
+ *  - emptyCells: Auto players use the solver once this few cells are empty
+ *  - deadline: Monotonic clock time (ns) to give up searching at, or 0
+ *  - timedOut: Whether the last search gave up at the deadline
+ */
+typedef struct {
+    int height;
+    int width;
+    int numTiles;
+    int* numPlacements;
+    Placement** placements;
+    SolverEntry* table;
+    unsigned long tableMask;
+    unsigned long tableUsed;
+    unsigned long long nodes;
+    int emptyCells;
+    long long deadline;
+    bool timedOut;
+} Solver;
+
+/*
+ * Number of legal placements of each tile, kept up to date as tiles are
+ * placed. A placement only stops being legal when a cell it covers is
+ * filled, so each placement only affects placements centred within
+ * TILE_SIZE - 1 rows and columns of it.
+ *  - numTiles: Number of tiles in the tile cycle
+ *  - rotations: All four rotations of every tile
+ *  - counts: Number of legal positions for each tile and rotation
+ */
+typedef struct {
+    int numTiles;
+    char (*rotations)[4][TILE_SIZE][TILE_SIZE];
+    long (*counts)[4];
+} Mobility;
+
+/*
+ * Header of an opening book file, stored in native byte order so the file
+ * can be used directly after being memory mapped
+ *  - magic: BOOK_MAGIC
+ *  - version: BOOK_VERSION
+ *  - height, width: Dimensions of the board the book is for
+ *  - numTiles: Number of tiles in the tilefile the book is for
+ *  - tilesHash: FNV-1a hash of the tiles the book is for
+ *  - numSlots: Number of BookEntry slots following (a power of two)
+ */
+typedef struct {
+    char magic[4];
+    int version;
+    int height;
+    int width;
+    int numTiles;
+    unsigned int tilesHash;
+    unsigned long numSlots;
+} BookHeader;
+
+/*
+ * Slot of an opening book's open addressing hash table
+ *  - key: Position key from get_book_key, or 0 if slot is empty
+ *  - row, column: Centre of the best move from this position
+ *  - rotation: Degrees to rotate the tile by for the best move
+ */
+typedef struct {
+    unsigned long long key;
+    short row;
+    short column;
+    short rotation;
+} BookEntry;
+
+/*
+ * An opening book, either being generated or memory mapped from a file
+ *  - header: Book header (at the start of the mapping if mapped)
+ *  - slots: Hash table of positions to best moves
+ *  - size: Size in bytes of the mapping, or 0 if not mapped
+ */
+typedef struct {
+    BookHeader* header;
+    BookEntry* slots;
+    long size;
+} OpeningBook;
+
+/*
+ * State of incremental (delta) saving. A delta save is a full base savefile
+ * plus an append-only journal of the moves made since the base was written.
+ *  - enabled: Whether saves are done incrementally
+ *  - base: malloc'ed path of the current base savefile, or NULL if none
+ *  - baseHash: FNV-1a hash of the base savefile contents
+ *  - baseSize: Size in bytes of the base savefile
+ *  - numTiles: Number of tiles in the tilefile journal moves index into
+ *  - journal: Stream of the journal belonging to base, or NULL if the next
+ *    save must write a full base
+ *  - journalSize: Size in bytes of the journal so far
+ *  - pending: Moves made since the last save
+ *  - numPending: Number of moves in pending
+ *  - pendingCapacity: Number of moves pending has space for
+ */
+typedef struct {
+    bool enabled;
+    char* base;
+    unsigned int baseHash;
+    long baseSize;
+    int numTiles;
+    FILE* journal;
+    long journalSize;
+    MoveRecord* pending;
+    int numPending;
+    int pendingCapacity;
+} DeltaSave;
+
+/*
+ * Block of consecutive grid rows shared between a game and its snapshots
+ *  - refs: Number of games whose grid uses this page
+ *  - cells: GRID_PAGE_ROWS null terminated rows stored back to back
+ */
+typedef struct {
+    int refs;
+    char* cells;
+} GridPage;
+
+/*
+ * Occupancy bitboards of the grid at all four rotations, so a placement at
+ * any rotation can be checked with the unrotated tile's row masks.
+ * View k is the grid turned 90 * k degrees anticlockwise, so placing the
+ * unrotated tile on it covers the same cells as placing the tile rotated
+ * 90 * k degrees on the grid. Views have VIEW_PADDING occupied rows and
+ * columns on every side, so checks need no bounds tests.
+ *  - heights, widths: Size of each view, not counting padding
+ *  - rowWords: Number of 64 bit words in each padded row of a view
+ *  - bits: Padded rows of each view. Bit x of a row is column
+ *    x - VIEW_PADDING, set if the cell is occupied.
+ */
+typedef struct {
+    int heights[4];
+    int widths[4];
+    int rowWords[4];
+    unsigned long long* bits[4];
+} BoardViews;
+
 /* 
  * Stores details of a fitz game
  *  - height: Height of the game grid
  *  - width: Width of the game grid
- *  - grid: The game grid
+ *  - grid: The game grid, rows point into pages
+ *  - pages: Pages grid rows are stored in, possibly shared with snapshots
+ *  - numPages: Number of pages
  *  - currentTile: Tile being placed by current player (starting from 0)
  *  - currentPlayer: Player whose turn it is currently (0 for P1, 1 for P2)
  *  - playerTypes: Array specifying the player types for each player
  *  - lastPlay: Stores the last move for each player
  *  - numMoves: Total number of successful moves so far this game
  *  - savefile: Path to savefile if loaded from, otherwise NULL.
+ *  - moveLog: Stream every placement is appended to, otherwise NULL.
+ *  - delta: State of incremental saving
+ *  - endgame: Solver mobility players use near the end of a game, or NULL
+ *  - positionHash: Zobrist style hash of the occupied cells of the grid
+ *  - book: Opening book mobility players look moves up in, or NULL
+ *  - mobility: Legal placement counts kept up to date, or NULL if not needed
+ *  - renderMode: RENDER_FULL, RENDER_DIFF or RENDER_QUIET
+ *  - dirtyTop, dirtyBottom: Rows changed by the last move (-1 if none yet)
+ *  - stats: Analytics every move is recorded in, or NULL
+ *  - randomState: State of random players' number generator
+ *  - epsilon: Chance an epsilon-greedy player moves randomly
+ *  - moveBudget: Milliseconds auto players may take per move, or 0
+ *  - deadline: Monotonic clock time (ns) the current move must be made by,
+ *    or 0 if there is no deadline
+ *  - searchNodes: Positions searched so far this move
+ *  - fallback: Legal placement of the current tile found by is_game_over,
+ *    played if an auto player runs out of time
+ *  - script: Script human players' moves are read from, or NULL to prompt
+ *  - views: Rotated occupancy bitboards kept up to date, or NULL if not used
+ *  - pool: Threads large first-fit searches are shared with, or NULL
  */
 typedef struct {
     int height;
     int width;
     char** grid;
+    GridPage** pages;
+    int numPages;
     int currentTile;
     int currentPlayer;
     int playerTypes[2];
     PreviousMove lastPlay[2];
     int numMoves;
     char* savefile;
+    FILE* moveLog;
+    DeltaSave delta;
+    Solver* endgame;
+    unsigned long long positionHash;
+    OpeningBook* book;
+    Mobility* mobility;
+    int renderMode;
+    int dirtyTop;
+    int dirtyBottom;
+    Stats* stats;
+    unsigned long long randomState;
+    double epsilon;
+    int moveBudget;
+    long long deadline;
+    long searchNodes;
+    PreviousMove fallback;
+    Script* script;
+    BoardViews* views;
+    struct SearchPool* pool;
 } Game;
 
+/*
+ * A first-fit search shared between the threads of a search pool.
+ * Positions in scan order are numbered from 0, and threads take chunks of
+ * chunkSize of them in order.
+ *  - game: Game being searched
+ *  - rotations: Tile at each rotation (0, 90, 180, 270)
+ *  - masks: Row masks of the unrotated tile, used if the game has views
+ *  - order: SEARCH_ROTATIONS_INNER or SEARCH_ROTATIONS_OUTER
+ *  - rowLow, columnLow: Lowest row and column scanned
+ *  - columns: Number of columns scanned in each row
+ *  - numPositions: Number of (row, column) positions scanned
+ *  - startOffset: Number of positions before the start position
+ *  - chunkSize: Number of placements in each chunk
+ *  - deadline: Monotonic clock time (ns) to give up by, or 0
+ *  - nextChunk: Next chunk for a thread to take
+ *  - found: First legal placement found so far, or LONG_MAX. Threads stop
+ *    once every placement left to them comes after it.
+ *  - timedOut: Whether a thread gave up at the deadline
+ */
+typedef struct {
+    Game* game;
+    char (*rotations)[TILE_SIZE][TILE_SIZE];
+    unsigned int* masks;
+    int order;
+    int rowLow;
+    int columnLow;
+    int columns;
+    long numPositions;
+    long startOffset;
+    long chunkSize;
+    long long deadline;
+    long nextChunk;
+    long found;
+    bool timedOut;
+} FitSearch;
+
+/*
+ * Threads kept running to share first-fit searches of large grids
+ *  - numThreads: Number of threads searching, including the one that
+ *    starts a search
+ *  - lock: Protects the rest of the pool
+ *  - started: Signalled when a search is started
+ *  - finished: Signalled when the last pool thread finishes a search
+ *  - generation: Number of searches started
+ *  - busy: Number of pool threads still working on the current search
+ *  - search: Current search
+ */
+typedef struct SearchPool {
+    int numThreads;
+    pthread_mutex_t lock;
+    pthread_cond_t started;
+    pthread_cond_t finished;
+    long generation;
+    int busy;
+    FitSearch* search;
+} SearchPool;
+
+/*
+ * Work given to one batch simulation thread
+ *  - options: Command line options
+ *  - game: Starting position of every batch game, which each game forks
+ *  - numTiles, tiles: Tiles loaded from tilefile
+ *  - index: Thread number, starting from 0. Thread i plays every
+ *    batchThreads'th game starting from game i.
+ *  - stats: This thread's analytics, or NULL if not being gathered
+ *  - wins: Number of games won by each player on this thread
+ */
+typedef struct {
+    Options* options;
+    Game* game;
+    int numTiles;
+    char (*tiles)[TILE_SIZE][TILE_SIZE];
+    int index;
+    Stats* stats;
+    long wins[2];
+} BatchWorker;
+
+// Frame all grid and tile printing is built in, reused between prints
+Frame outputFrame;
+
 /* Main game functions */
-void run_game_loop(Game* game, int numTiles, 
+int run_game_loop(Game* game, int numTiles, 
+        char tiles[numTiles][TILE_SIZE][TILE_SIZE], char* checkpointFile);
+void initialise_game(Game* game, int numTiles,
         char tiles[numTiles][TILE_SIZE][TILE_SIZE]);
-void initialise_game(Game* game, int numTiles);
+int parse_options(int argc, char** argv, Options* options);
 void parse_cmd_arguments(int argc, char** argv, Game* game);
 
+/* Batch simulation functions */
+Stats* create_stats(int height, int width, int numTiles);
+void record_move(Stats* stats, Game* game, char tile[TILE_SIZE][TILE_SIZE]);
+void merge_stats(Stats* dest, Stats* src);
+void write_stats(Stats* stats, char* filename);
+void* run_batch_thread(void* arg);
+void run_batch(Options* options, Game* game, int numTiles,
+        char tiles[numTiles][TILE_SIZE][TILE_SIZE]);
+
 /* Tilefile functions */
 int check_tilefile(char* filename);
-void load_tiles(char* filename, int numTiles, 
-        char tiles[numTiles][TILE_SIZE][TILE_SIZE]);
        
 /* Savefile functions */
-void load_savefile_grid(Game* game, char* filename);
+void load_savefile(Game* game, int numTiles);
+char* format_savefile(Game* game, long* size);
 bool write_savefile(Game* game, char* filename);
+bool save_game(Game* game, char* filename);
+
+/* Delta savefile functions */
+unsigned int hash_bytes(const char* data, long size);
+char* get_journal_path(char* filename);
+bool write_delta_savefile(Game* game, char* filename);
+void load_savefile_journal(Game* game, int numTiles,
+        char tiles[numTiles][TILE_SIZE][TILE_SIZE]);
+
+/* Move log functions */
+void open_move_log(Game* game, char* filename, int numTiles);
+void write_move_record(FILE* file, MoveRecord* move);
+void read_move_record(unsigned char* data, MoveRecord* move);
+void replay_move_log(Options* options, int numTiles,
+        char tiles[numTiles][TILE_SIZE][TILE_SIZE]);
     
+/* Endgame solver functions */
+Solver* create_solver(int height, int width, int numTiles,
+        char tiles[numTiles][TILE_SIZE][TILE_SIZE], int memory);
+unsigned long long get_occupied_cells(Game* game);
+bool solve_position(Solver* solver, unsigned long long occupied, int tile,
+        Placement** winningMove);
+void solve_savefile(Options* options, int numTiles,
+        char tiles[numTiles][TILE_SIZE][TILE_SIZE]);
+bool endgame_move(Game* game);
+
+/* Opening book functions */
+unsigned long long mix_bits(unsigned long long value);
+unsigned long long get_position_hash(Game* game);
+unsigned long long get_book_key(unsigned long long positionHash, int tile);
+BookEntry* find_book_entry(OpeningBook* book, unsigned long long key);
+void generate_book_moves(OpeningBook* book, Solver* solver,
+        unsigned long long occupied, unsigned long long positionHash,
+        int tile, int plies);
+void make_opening_book(Options* options, int height, int width,
+        int numTiles, char tiles[numTiles][TILE_SIZE][TILE_SIZE]);
+OpeningBook* load_opening_book(char* filename, Game* game, int numTiles,
+        char tiles[numTiles][TILE_SIZE][TILE_SIZE]);
+bool book_move(Game* game, char tile[TILE_SIZE][TILE_SIZE]);
+
+/* Mobility functions */
+Mobility* create_mobility(Game* game, int numTiles,
+        char tiles[numTiles][TILE_SIZE][TILE_SIZE]);
+long count_blocked_placements(Game* game, int tile,
+        char placed[TILE_SIZE][TILE_SIZE], int row, int column,
+        long blocked[4]);
+void update_mobility(Game* game, char placed[TILE_SIZE][TILE_SIZE],
+        int row, int column);
+long get_mobility(Game* game, int tile);
+
 /* Tile/rotation/placement logic */
-void rotate_tile(char tile[TILE_SIZE][TILE_SIZE], 
-        char destTile[TILE_SIZE][TILE_SIZE], int degrees);
 bool is_tile_placeable(Game* game, char tile[TILE_SIZE][TILE_SIZE], 
         int row, int column);
 bool is_game_over(Game* game, char tile[TILE_SIZE][TILE_SIZE]);
 void place_tile(Game* game, char tile[TILE_SIZE][TILE_SIZE], 
-        int row, int column);
+        int row, int column, int rotation);
+void get_tile_shape(char tile[TILE_SIZE][TILE_SIZE], TileShape* shape);
+BoardViews* create_views(Game* game);
+void free_views(BoardViews* views);
+void set_view_cell(BoardViews* views, int row, int column);
+void get_tile_masks(char tile[TILE_SIZE][TILE_SIZE],
+        unsigned int masks[TILE_SIZE]);
+bool is_view_placeable(BoardViews* views, unsigned int masks[TILE_SIZE],
+        int row, int column, int rotation);
+SearchPool* create_search_pool(int numThreads);
+void* run_search_thread(void* arg);
+bool is_search_placeable(FitSearch* search, long index, PreviousMove* move);
+void search_chunks(FitSearch* search);
+int parallel_first_fit(Game* game, char tile[TILE_SIZE][TILE_SIZE],
+        int order, int bounds[4], int rowStart, int columnStart,
+        long long deadline, PreviousMove* move);
+int generate_row_moves(Game* game, TileShape shapes[4], int row,
+        PreviousMove* moves);
+
+/* Snapshot functions */
+void create_grid(Game* game);
+void fork_game(Game* game, Game* snapshot);
+void release_game(Game* game);
+void make_rows_writable(Game* game, int top, int bottom);
         
 /* Printing functions */
+char* reserve_frame(Frame* frame, long extra);
+void emit_frame(Frame* frame);
 void print_tile(char tile[TILE_SIZE][TILE_SIZE]);
 void print_tilefile(int numTiles, char tiles[numTiles][TILE_SIZE][TILE_SIZE]);
 void print_grid(Game* game);
+void print_move(Game* game);
 
 /* Next move processing */
 bool prompt_user(Game* game, char tile[TILE_SIZE][TILE_SIZE]);
+char* next_script_line(Script* script, long* length);
+void parse_script_line(char* line, long length, ScriptLine* parsed);
+bool script_move(Game* game, char rotations[4][TILE_SIZE][TILE_SIZE]);
+void report_script_errors(Script* script);
 void auto_type_one_move(Game* game, char tile[TILE_SIZE][TILE_SIZE]);
 void auto_type_two_move(Game* game, char tile[TILE_SIZE][TILE_SIZE]);
+void auto_mobility_move(Game* game, char tile[TILE_SIZE][TILE_SIZE]);
+void random_move(Game* game, char tile[TILE_SIZE][TILE_SIZE],
+        double epsilon);
+void fallback_move(Game* game, char tile[TILE_SIZE][TILE_SIZE]);
 
 /* Game exiting */
 void exit_game(int exitCode);
 
 /* Helper functions */
 bool read_line(char* buffer, int maxLength, FILE* fileStream, int lineNum);
-bool is_valid_input_line(char* input, int numInputs);
 int get_player_type(char* input);
 int str_to_int(char* str, bool* error);
+unsigned long long start_random(int seed, int gameNumber);
+unsigned long long next_random(Game* game);
+long long get_clock_ns(void);
+bool is_out_of_time(Game* game);
 
 int main(int argc, char** argv) {
-    if ((argc != 2) && (argc != 5) && (argc != 6)) {
+    Options options = {.replayPly = -1, .solverMemory = SOLVER_DEFAULT_MEMORY,
+            .endgameCells = -1, .bookPlies = BOOK_DEFAULT_PLIES,
+            .batchThreads = 1, .epsilon = DEFAULT_EPSILON,
+            .searchThreads = 1};
+    argc = parse_options(argc, argv, &options);
+
+    if ((argc != 2) && (argc != 5) && (argc != 6)
+            && !(argc == 4 && options.makeBookFile != NULL)) {
         exit_game(ERROR_INCORRECT_ARGS);
     }
 
     Game game;
+    memset(&game, 0, sizeof(Game));
     
     char* tilefileName = argv[1];
     int numTiles = check_tilefile(tilefileName);
     
     char tiles[numTiles][TILE_SIZE][TILE_SIZE];
-    load_tiles(tilefileName, numTiles, tiles);
+    if (!load_tiles(tilefileName, numTiles, tiles)) {
+        exit_game(ERROR_TILEFILE_UNREADABLE);
+    }
     
-    // If just given tilefile, print and exit.
-    if (argc == 2) {
+    // If just given tilefile, print (or replay/solve a game) and exit.
+    if (argc == 2 && options.replayFile != NULL) {
+        replay_move_log(&options, numTiles, tiles);
+        return 0;
+    } else if (argc == 2 && options.solveFile != NULL) {
+        solve_savefile(&options, numTiles, tiles);
+        return 0;
+    } else if (argc == 2) {
         print_tilefile(numTiles, tiles);
         return 0;
+    } else if (argc == 4) {
+        bool notValid = false;
+        int height = str_to_int(argv[2], &notValid);
+        int width = str_to_int(argv[3], &notValid);
+        if (notValid || height < 1 || width < 1
+                || height * width > SOLVER_MAX_CELLS) {
+            exit_game(ERROR_INVALID_DIMENSIONS);
+        }
+        make_opening_book(&options, height, width, numTiles, tiles);
+        return 0;
     } else {
         parse_cmd_arguments(argc, argv, &game);
     }
     
-    initialise_game(&game, numTiles);
+    if (options.batchGames > 0) {
+        if (argc != 6) {
+            exit_game(ERROR_INCORRECT_ARGS);
+        }
+        run_batch(&options, &game, numTiles, tiles);
+        return 0;
+    }
+
+    game.delta.enabled = options.deltaSaves;
+    game.delta.numTiles = numTiles;
+    game.renderMode = options.renderMode;
+    game.randomState = start_random(options.seed, 0);
+    game.epsilon = options.epsilon;
+    game.moveBudget = options.moveBudget;
+    if (options.scripted) {
+        game.script = calloc(1, sizeof(Script));
+    }
+    initialise_game(&game, numTiles, tiles);
+    if (options.moveLogFile != NULL) {
+        open_move_log(&game, options.moveLogFile, numTiles);
+    }
+    if (options.endgameCells >= 0
+            && game.height * game.width <= SOLVER_MAX_CELLS) {
+        game.endgame = create_solver(game.height, game.width, numTiles,
+                tiles, options.solverMemory);
+        game.endgame->emptyCells = options.endgameCells;
+    }
+    if (game.playerTypes[0] == PLAYER_TYPE_AUTO_MOBILITY
+            || game.playerTypes[1] == PLAYER_TYPE_AUTO_MOBILITY) {
+        game.mobility = create_mobility(&game, numTiles, tiles);
+    }
+    if (options.bookFile != NULL) {
+        game.book = load_opening_book(options.bookFile, &game, numTiles,
+                tiles);
+    }
+    if (options.boardViews) {
+        game.views = create_views(&game);
+    }
+    if (options.searchThreads > 1) {
+        game.pool = create_search_pool(options.searchThreads);
+    }
     print_grid(&game);
-    run_game_loop(&game, numTiles, tiles);
+    run_game_loop(&game, numTiles, tiles, options.checkpointFile);
             
     return 0;
 }
@@ -147,23 +838,45 @@ int main(int argc, char** argv) {
  * @param game Game struct
  * @param numTiles Number of tiles loaded from tilefile
  * @param tiles Tiles loaded from tilefile
+ * @param checkpointFile Path to save game to after every move, or NULL
+ * @return Player who won the game
  * @exit ERROR_EOF if end of input occurs unexpectedly
  */
-void run_game_loop(Game* game, int numTiles, 
-        char tiles[numTiles][TILE_SIZE][TILE_SIZE]) {
+int run_game_loop(Game* game, int numTiles, 
+        char tiles[numTiles][TILE_SIZE][TILE_SIZE], char* checkpointFile) {
             
     while (true) {
+        int currentPlayerType = game->playerTypes[game->currentPlayer];
+        game->deadline = 0;
+        if (game->moveBudget > 0 && currentPlayerType != PLAYER_TYPE_HUMAN) {
+            game->deadline = get_clock_ns() + game->moveBudget * 1000000LL;
+            game->searchNodes = 0;
+        }
+
         // Check if OTHER player has won
         if (is_game_over(game, tiles[game->currentTile])) {
-            printf("Player %c wins\n", 
-                    PLAYER_SYMBOL(!game->currentPlayer));
-            return;
+            if (game->renderMode != RENDER_NONE) {
+                printf("Player %c wins\n", 
+                        PLAYER_SYMBOL(!game->currentPlayer));
+            }
+            if (game->script != NULL) {
+                report_script_errors(game->script);
+            }
+            return !game->currentPlayer;
         }
         
-        int currentPlayerType = game->playerTypes[game->currentPlayer];
-        
-        if (currentPlayerType == PLAYER_TYPE_HUMAN) {
-            print_tile(tiles[game->currentTile]);
+        if (currentPlayerType == PLAYER_TYPE_HUMAN && game->script != NULL) {
+            char rotations[4][TILE_SIZE][TILE_SIZE];
+            for (int i = 0; i < 4; i++) {
+                rotate_tile(tiles[game->currentTile], rotations[i], i * 90);
+            }
+            while (!script_move(game, rotations)) {
+                // Keep reading lines until one is a legal move
+            }
+        } else if (currentPlayerType == PLAYER_TYPE_HUMAN) {
+            if (game->renderMode != RENDER_QUIET) {
+                print_tile(tiles[game->currentTile]);
+            }
             
             while (true) {
                 // If user inputs a valid move, stop prompting them and go on
@@ -171,10 +884,54 @@ void run_game_loop(Game* game, int numTiles,
                     break;
                 }     
             }
+        } else if (currentPlayerType == PLAYER_TYPE_AUTO_MOBILITY
+                && game->book != NULL
+                && book_move(game, tiles[game->currentTile])) {
+            // Mobility player found the position in the opening book
+        } else if (currentPlayerType == PLAYER_TYPE_AUTO_MOBILITY
+                && game->endgame != NULL && endgame_move(game)) {
+            // Mobility player found a winning move with the endgame solver
         } else if (currentPlayerType == PLAYER_TYPE_AUTO_ONE) {
             auto_type_one_move(game, tiles[game->currentTile]);
         } else if (currentPlayerType == PLAYER_TYPE_AUTO_TWO) {
             auto_type_two_move(game, tiles[game->currentTile]);
+        } else if (currentPlayerType == PLAYER_TYPE_AUTO_MOBILITY) {
+            auto_mobility_move(game, tiles[game->currentTile]);
+        } else if (currentPlayerType == PLAYER_TYPE_RANDOM) {
+            random_move(game, tiles[game->currentTile], 1.0);
+        } else if (currentPlayerType == PLAYER_TYPE_EPSILON) {
+            random_move(game, tiles[game->currentTile], game->epsilon);
+        }
+
+        PreviousMove* last = &game->lastPlay[game->currentPlayer];
+        MoveRecord move = {game->currentTile, last->row, last->column,
+                last->rotation, game->currentPlayer};
+        if (game->moveLog != NULL) {
+            write_move_record(game->moveLog, &move);
+        }
+
+        // Remember move for the next delta save's journal. Once the journal
+        // would grow as big as its base, the next save writes a full base
+        // instead, so the journal is closed and no more moves are kept.
+        DeltaSave* delta = &game->delta;
+        if (delta->journal != NULL && delta->journalSize
+                + (delta->numPending + 1L) * MOVELOG_RECORD_SIZE
+                >= delta->baseSize) {
+            fclose(delta->journal);
+            delta->journal = NULL;
+            delta->numPending = 0;
+        }
+        if (delta->enabled && delta->journal != NULL) {
+            if (delta->numPending == delta->pendingCapacity) {
+                delta->pendingCapacity = delta->pendingCapacity * 2 + 16;
+                delta->pending = realloc(delta->pending,
+                        sizeof(MoveRecord) * delta->pendingCapacity);
+            }
+            delta->pending[delta->numPending++] = move;
+        }
+
+        if (game->stats != NULL) {
+            record_move(game->stats, game, tiles[game->currentTile]);
         }
 
         print_grid(game);
@@ -186,6 +943,10 @@ void run_game_loop(Game* game, int numTiles,
         } else {
             game->currentTile = game->currentTile + 1;
         }
+
+        if (checkpointFile != NULL && !save_game(game, checkpointFile)) {
+            fprintf(stderr, "Unable to save game\n");
+        }
     }
 }
 
@@ -193,58 +954,151 @@ void run_game_loop(Game* game, int numTiles,
  * Initialises game struct. If there is a savefile to load, will load data
  * from savefile and initialise game to that state if valid to do so.
  *
+ * If the savefile has a journal from delta saving, its moves are replayed
+ * on top of the savefile grid.
+ *
  * @param game Game struct to initialise
  * @param numTiles Number of tiles loaded from tilefile
+ * @param tiles Tiles loaded from tilefile
  * @exit ERROR_SAVEFILE_UNREADABLE if savefile can't be open/read
  * @exit ERROR_SAVEFILE_INVALID if savefile is invalid
  */
-void initialise_game(Game* game, int numTiles) {
+void initialise_game(Game* game, int numTiles,
+        char tiles[numTiles][TILE_SIZE][TILE_SIZE]) {
     game->currentPlayer = PLAYER_ONE;
     game->currentTile = 0;
     game->numMoves = 0; 
+    game->dirtyTop = -1;
+    game->dirtyBottom = -1;
 
     if (game->savefile != NULL) {
-        FILE* file = fopen(game->savefile, "r");
-        if (file == NULL) {
-            exit_game(ERROR_SAVEFILE_UNREADABLE);
+        load_savefile(game, numTiles);
+        load_savefile_journal(game, numTiles, tiles);
+    } else {
+        // Allocate and initialise memory for grid. Rows are null terminated.
+        create_grid(game);
+        for (int i = 0; i < game->height; i++) {
+            memset(game->grid[i], EMPTY_GRID_CELL, game->width);
         }
-        char inputBuffer[INITIAL_BUFFER];
-        read_line(inputBuffer, INITIAL_BUFFER, file, 0);
-        
-        // Check line is four single space separated integers.
-        if (!is_valid_input_line(inputBuffer, 4)) {
-            exit_game(ERROR_SAVEFILE_INVALID); 
+    }
+    game->positionHash = get_position_hash(game);
+}
+
+/*
+ * Parses and removes options starting with "--" from the command line,
+ * leaving the remaining arguments in order for parse_cmd_arguments.
+ *
+ * Recognised options:
+ *  --log FILE      Append every placement made this game to a move log
+ *  --replay FILE   Replay a move log instead of playing (tilefile only)
+ *  --ply N         Stop replaying after the first N moves
+ *  --verify        Check every logged move is legal before replaying
+ *  --delta-save    Save incrementally as a base savefile plus move journal
+ *  --checkpoint F  Delta save the game to F after every move
+ *  --solve F       Find the winner of savefile F on a small board
+ *  --solver-mb N   Megabytes the solver's position table may use
+ *  --endgame N     Mobility players solve exactly once N or less cells empty
+ *  --book F        Mobility players play moves found in opening book F
+ *  --make-book F   Generate opening book F (given tilefile height width)
+ *  --book-plies N  Number of opening moves to generate a book for
+ *  --diff          After each move, only print rows it changed
+ *  --quiet         Only print moves and the winner, not grids or tiles
+ *  --batch N       Simulate N auto player games and print how many each won
+ *  --threads N     Number of threads to simulate batch games with
+ *  --stats F       Write analytics of batch games to F as CSV
+ *  --seed N        Seed random players' moves with N
+ *  --epsilon E     Chance (0 to 1) epsilon-greedy players move randomly
+ *  --budget MS     Auto players make their best move so far after MS ms
+ *  --script        Read human moves from stdin as a script, without prompts
+ *  --views         Check auto player placements on rotated board bitmaps
+ *  --search-threads N  Share first-fit searches of large grids between N
+ *                  threads (not used by batch games)
+ *
+ * @param argc Argument count passed from main()
+ * @param argv Arguments passed from main(). Options are removed in place.
+ * @param options Destination to store options given
+ * @return Number of arguments left in argv
+ * @exit ERROR_INCORRECT_ARGS if an option is unknown or missing its value
+ */
+int parse_options(int argc, char** argv, Options* options) {
+    int remaining = 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--", 2) != 0) {
+            argv[remaining++] = argv[i];
+            continue;
         }
-        
-        int nextTile, currentPlayer, height, width;
-        sscanf(inputBuffer, "%d %d %d %d", 
-                &nextTile, &currentPlayer, &height, &width);
-        
-        // Check savefile data is correct
-        if ((currentPlayer != 0 && currentPlayer != 1) ||
-                (height < 1) || (height > MAX_BOARD_SIZE) || 
-                (width < 1) || (width > MAX_BOARD_SIZE) ||
-                (nextTile >= numTiles) || (nextTile < 0)) {
-            exit_game(ERROR_SAVEFILE_INVALID);
+
+        bool hasValue = (i + 1 < argc);
+        bool notValid = false;
+        if (strcmp(argv[i], "--log") == 0 && hasValue) {
+            options->moveLogFile = argv[++i];
+        } else if (strcmp(argv[i], "--replay") == 0 && hasValue) {
+            options->replayFile = argv[++i];
+        } else if (strcmp(argv[i], "--ply") == 0 && hasValue) {
+            options->replayPly = str_to_int(argv[++i], &notValid);
+        } else if (strcmp(argv[i], "--verify") == 0) {
+            options->verifyReplay = true;
+        } else if (strcmp(argv[i], "--delta-save") == 0) {
+            options->deltaSaves = true;
+        } else if (strcmp(argv[i], "--checkpoint") == 0 && hasValue) {
+            options->checkpointFile = argv[++i];
+            options->deltaSaves = true;
+        } else if (strcmp(argv[i], "--solve") == 0 && hasValue) {
+            options->solveFile = argv[++i];
+        } else if (strcmp(argv[i], "--solver-mb") == 0 && hasValue) {
+            options->solverMemory = str_to_int(argv[++i], &notValid);
+            notValid = notValid || options->solverMemory < 1;
+        } else if (strcmp(argv[i], "--book") == 0 && hasValue) {
+            options->bookFile = argv[++i];
+        } else if (strcmp(argv[i], "--make-book") == 0 && hasValue) {
+            options->makeBookFile = argv[++i];
+        } else if (strcmp(argv[i], "--book-plies") == 0 && hasValue) {
+            options->bookPlies = str_to_int(argv[++i], &notValid);
+            notValid = notValid || options->bookPlies < 1;
+        } else if (strcmp(argv[i], "--diff") == 0) {
+            options->renderMode = RENDER_DIFF;
+        } else if (strcmp(argv[i], "--quiet") == 0) {
+            options->renderMode = RENDER_QUIET;
+        } else if (strcmp(argv[i], "--batch") == 0 && hasValue) {
+            options->batchGames = str_to_int(argv[++i], &notValid);
+            notValid = notValid || options->batchGames < 1;
+        } else if (strcmp(argv[i], "--threads") == 0 && hasValue) {
+            options->batchThreads = str_to_int(argv[++i], &notValid);
+            notValid = notValid || options->batchThreads < 1;
+        } else if (strcmp(argv[i], "--script") == 0) {
+            options->scripted = true;
+        } else if (strcmp(argv[i], "--views") == 0) {
+            options->boardViews = true;
+        } else if (strcmp(argv[i], "--search-threads") == 0 && hasValue) {
+            options->searchThreads = str_to_int(argv[++i], &notValid);
+            notValid = notValid || options->searchThreads < 1;
+        } else if (strcmp(argv[i], "--budget") == 0 && hasValue) {
+            options->moveBudget = str_to_int(argv[++i], &notValid);
+            notValid = notValid || options->moveBudget < 1;
+        } else if (strcmp(argv[i], "--seed") == 0 && hasValue) {
+            options->seed = str_to_int(argv[++i], &notValid);
+        } else if (strcmp(argv[i], "--epsilon") == 0 && hasValue) {
+            char* end;
+            options->epsilon = strtod(argv[++i], &end);
+            notValid = *end != '\0' || *argv[i] == '\0'
+                    || !(options->epsilon >= 0 && options->epsilon <= 1);
+        } else if (strcmp(argv[i], "--stats") == 0 && hasValue) {
+            options->statsFile = argv[++i];
+        } else if (strcmp(argv[i], "--endgame") == 0 && hasValue) {
+            options->endgameCells = str_to_int(argv[++i], &notValid);
+            notValid = notValid || options->endgameCells < 0;
+        } else {
+            notValid = true;
         }
-                
-        game->currentPlayer = currentPlayer;
-        game->currentTile = nextTile;
-        game->height = height;
-        game->width = width;
-    }
-    // Allocate and initialise memory for grid
-    game->grid = malloc(sizeof(char*) * game->height);
-    for (int i = 0; i < game->height; i++) {
-        game->grid[i] = malloc(sizeof(char*) * game->width);
-        for (int j = 0; j < game->width; j++) {
-            game->grid[i][j] = EMPTY_GRID_CELL;
+
+        if (notValid || options->replayPly < -1) {
+            exit_game(ERROR_INCORRECT_ARGS);
         }
     }
-    // Load grid from savefile if needed, after memory allocated
-    if (game->savefile != NULL) {
-        load_savefile_grid(game, game->savefile);
-    }
+
+    argv[remaining] = NULL;
+    return remaining;
 }
 
 /*
@@ -286,195 +1140,1417 @@ void parse_cmd_arguments(int argc, char** argv, Game* game) {
 }
 
 /*
- * Checks the tilefile is valid and returns how many tiles in file
- * A valid tilefile must contain exactly TILE_SIZE rows of TILE_SIZE length, 
- * with each row ending in \n. Tiles must be separated by an extra \n.
+ * Allocates analytics for a batch of games, with every counter zeroed.
  *
- * @param filename Path to tilefile to check
- * @return Number of tiles in the tilefile
- * @exit ERROR_TILEFILE_UNREADABLE if tilefile can't be read/opened
- * @exit ERROR_TILEFILE_INVALID if tilefile is invalid
+ * @param height Height of the grid games are played on
+ * @param width Width of the grid games are played on
+ * @param numTiles Number of tiles in the tile cycle
+ * @return Analytics struct
  */
-int check_tilefile(char* filename) {
-    FILE* file = fopen(filename, "r");
-    if (file == NULL) {
-        exit_game(ERROR_TILEFILE_UNREADABLE);
-    }
+Stats* create_stats(int height, int width, int numTiles) {
+    Stats* stats = calloc(1, sizeof(Stats));
+    stats->height = height;
+    stats->width = width;
+    stats->numTiles = numTiles;
+    stats->cellHits = calloc(2L * height * width, sizeof(long));
+    stats->lengths = calloc((long) numTiles * STATS_LENGTH_BUCKETS,
+            sizeof(long));
+    // A game lasts at most one move per cell, as every tile covers a cell
+    stats->bucketSize = height * width / STATS_LENGTH_BUCKETS + 1;
 
-    int numTiles = 0;
-    char curr;
-    
-    while (true) {
-        for (int row = 0; row < TILE_SIZE; row++) {
-            // Check there exactly TILE_SIZE valid characters in row
-            for (int column = 0; column < TILE_SIZE; column++) {
-                curr = fgetc(file);
-                if (curr != EMPTY_TILE_CELL && curr != OCCUPIED_TILE_CELL) {
-                    exit_game(ERROR_TILEFILE_INVALID);
-                }
-            }
-            // Next character must be newline
-            curr = fgetc(file);
-            if (curr != '\n') {
-                exit_game(ERROR_TILEFILE_INVALID);
+    return stats;
+}
+
+/*
+ * Records the move the current player just made.
+ *
+ * @param stats Analytics to record move in
+ * @param game Game struct, with the move in the current player's last play
+ * @param tile Tile that was placed, before being rotated
+ */
+void record_move(Stats* stats, Game* game, char tile[TILE_SIZE][TILE_SIZE]) {
+    PreviousMove* last = &game->lastPlay[game->currentPlayer];
+    char placed[TILE_SIZE][TILE_SIZE];
+    rotate_tile(tile, placed, last->rotation);
+
+    long* hits = stats->cellHits
+            + (long) game->currentPlayer * stats->height * stats->width;
+    for (int i = 0; i < TILE_SIZE; i++) {
+        int row = last->row - 2 + i;
+        for (int j = 0; j < TILE_SIZE; j++) {
+            int column = last->column - 2 + j;
+            if (placed[i][j] != EMPTY_TILE_CELL) {
+                hits[row * stats->width + column]++;
             }
         }
-        numTiles++;
-        
-        curr = fgetc(file);
-        if (curr == EOF) { // If file is finished, exit loop and return
-            break;
-        } else if (curr != '\n') { // If not finished, \n must seperate tiles
-            exit_game(ERROR_TILEFILE_INVALID);
-        }
     }
-    
-    return numTiles;
+    stats->rotations[game->currentPlayer][last->rotation / 90]++;
 }
 
 /*
- * Loads tilefile at specified filename into the given tiles array.
- * This function assumes the tilefile is already checked to be valid
- * and it is already known how many tiles are in the tilefile.
+ * Adds one set of analytics' counters to another's.
  *
- * @param filename Path of tilefile to load
- * @param numTiles Number of tiles in the tilefile
- * @param tiles Destination to store tiles loaded from file
- * @exit ERROR_TILEFILE_UNREADABLE if can't access tilefile at filename
+ * @param dest Analytics to add to
+ * @param src Analytics to add, for the same grid size and tiles
  */
-void load_tiles(char* filename, int numTiles, 
-        char tiles[numTiles][TILE_SIZE][TILE_SIZE]) {
-            
-    FILE* file = fopen(filename, "r");
-    if (file == NULL) {
-        exit_game(ERROR_TILEFILE_UNREADABLE);
+void merge_stats(Stats* dest, Stats* src) {
+    for (long i = 0; i < 2L * dest->height * dest->width; i++) {
+        dest->cellHits[i] += src->cellHits[i];
     }
-    
-    char curr;
-    for (int tile = 0; tile < numTiles; tile++) {
-        for (int row = 0; row < TILE_SIZE; row++) {
-            for (int column = 0; column < TILE_SIZE; column++) {
-                curr = fgetc(file);
-                tiles[tile][row][column] = curr;
-            }
-            // flush newline character between rows
-            curr = fgetc(file); 
+    for (int player = 0; player < 2; player++) {
+        for (int i = 0; i < 4; i++) {
+            dest->rotations[player][i] += src->rotations[player][i];
         }
-        // flush blank newline between each tile
-        curr = fgetc(file); 
+    }
+    for (long i = 0; i < (long) dest->numTiles * STATS_LENGTH_BUCKETS; i++) {
+        dest->lengths[i] += src->lengths[i];
     }
 }
 
 /*
- * Loads the grid stored in savefile. Assumes first line containing
- * game and grid information has already been processed and correctly stored.
+ * Writes analytics to a CSV file, as three tables separated by blank lines:
+ *  - cell,row,column,player1,player2: Times each player covered each cell
+ *  - rotation,degrees,player1,player2: Times each player used a rotation
+ *  - length,tile,moves,games: Number of games starting on each tile
+ *    lasting between moves and moves + bucketSize - 1 moves (empty buckets
+ *    are left out)
+ * A message is printed to stderr if the file can't be written.
  *
- * @param game Game struct
- * @param filename Path of savefile to load grid from
- * @exit ERROR_SAVEFILE_UNREADABLE if savefile can't be opened/read
- * @exit ERROR_SAVEFILE_INVALID if savefile is invalid
+ * @param stats Analytics to write
+ * @param filename Path of file to write to
  */
-void load_savefile_grid(Game* game, char* filename) {
-    FILE* file = fopen(filename, "r");
-    
+void write_stats(Stats* stats, char* filename) {
+    FILE* file = fopen(filename, "w");
     if (file == NULL) {
-        exit_game(ERROR_SAVEFILE_UNREADABLE);
+        fprintf(stderr, "Unable to write stats\n");
+        return;
     }
-    
-    char curr;
 
-    // Since first line of savefile is assumed to have already been read
-    while (curr = fgetc(file), curr != '\n') {
-        // Flush through the first line 
+    long cells = (long) stats->height * stats->width;
+    fprintf(file, "cell,row,column,player1,player2\n");
+    for (long i = 0; i < cells; i++) {
+        fprintf(file, "cell,%ld,%ld,%ld,%ld\n", i / stats->width,
+                i % stats->width, stats->cellHits[i],
+                stats->cellHits[cells + i]);
     }
-    
-    for (int row = 0; row < game->height; row++) {
-        for (int column = 0; column < game->width; column++) {
-            curr = fgetc(file);
-            if (curr != '.' && curr != '#' && curr != '*') {
-                exit_game(ERROR_SAVEFILE_INVALID);
+
+    fprintf(file, "\nrotation,degrees,player1,player2\n");
+    for (int i = 0; i < 4; i++) {
+        fprintf(file, "rotation,%d,%ld,%ld\n", i * 90,
+                stats->rotations[0][i], stats->rotations[1][i]);
+    }
+
+    fprintf(file, "\nlength,tile,moves,games\n");
+    for (int tile = 0; tile < stats->numTiles; tile++) {
+        for (int bucket = 0; bucket < STATS_LENGTH_BUCKETS; bucket++) {
+            long games = stats->lengths[tile * STATS_LENGTH_BUCKETS + bucket];
+            if (games > 0) {
+                fprintf(file, "length,%d,%d,%ld\n", tile,
+                        bucket * stats->bucketSize, games);
             }
-            game->grid[row][column] = curr;
-        }
-        // Each row must be ended with \n character
-        curr = fgetc(file);
-        if (curr != '\n') {
-            exit_game(ERROR_SAVEFILE_INVALID);
         }
     }
-    // Make sure file doesn't have extra lines it shouldn't have
-    curr = fgetc(file);
-    if (curr != EOF) {
-        exit_game(ERROR_SAVEFILE_INVALID);
+
+    if (fclose(file) != 0) {
+        fprintf(stderr, "Unable to write stats\n");
     }
 }
 
 /*
- * Writes savefile to given file.
+ * Plays this thread's share of a batch of games without printing anything,
+ * counting wins and gathering analytics in the thread's own counters.
+ * Game i starts on tile i modulo the number of tiles. Each game is a
+ * snapshot of the starting position (see fork_game), so it only copies
+ * the grid pages it places tiles on.
  *
- * @param filename Path to desired savefile location 
- * @return true if write successful, false otherwise
+ * @param arg BatchWorker for this thread
+ * @return NULL
  */
-bool write_savefile(Game* game, char* filename) {
+void* run_batch_thread(void* arg) {
+    BatchWorker* worker = (BatchWorker*) arg;
+    Options* options = worker->options;
+
+    for (int i = worker->index; i < options->batchGames;
+            i += options->batchThreads) {
+        Game game;
+        fork_game(worker->game, &game);
+        game.currentTile = i % worker->numTiles;
+        game.renderMode = RENDER_NONE;
+        // Game i's moves depend only on the seed, not how threads split up
+        game.randomState = start_random(options->seed, i);
+        game.epsilon = options->epsilon;
+        game.moveBudget = options->moveBudget;
+        game.stats = worker->stats;
+        if (game.playerTypes[0] == PLAYER_TYPE_AUTO_MOBILITY
+                || game.playerTypes[1] == PLAYER_TYPE_AUTO_MOBILITY) {
+            game.mobility = create_mobility(&game, worker->numTiles,
+                    worker->tiles);
+        }
+        if (options->boardViews) {
+            game.views = create_views(&game);
+        }
+
+        int startTile = game.currentTile;
+        int winner = run_game_loop(&game, worker->numTiles, worker->tiles,
+                NULL);
+        worker->wins[winner]++;
+        if (worker->stats != NULL) {
+            int bucket = game.numMoves / worker->stats->bucketSize;
+            if (bucket >= STATS_LENGTH_BUCKETS) {
+                bucket = STATS_LENGTH_BUCKETS - 1;
+            }
+            worker->stats->lengths[startTile * STATS_LENGTH_BUCKETS
+                    + bucket]++;
+        }
+
+        release_game(&game);
+        if (game.mobility != NULL) {
+            free(game.mobility->rotations);
+            free(game.mobility->counts);
+            free(game.mobility);
+        }
+        if (game.views != NULL) {
+            free_views(game.views);
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * Simulates a batch of games between two auto players across
+ * options->batchThreads threads, then prints how many games each player
+ * won. If options->statsFile is set, every thread's analytics are added
+ * together once all threads have finished and written to it.
+ *
+ * @param options Command line options
+ * @param game Game struct with player types and dimensions set
+ * @param numTiles Number of tiles loaded from tilefile
+ * @param tiles Tiles loaded from tilefile
+ * @exit ERROR_INVALID_PLAYER_TYPE if either player is human
+ */
+void run_batch(Options* options, Game* game, int numTiles,
+        char tiles[numTiles][TILE_SIZE][TILE_SIZE]) {
+    if (game->playerTypes[0] == PLAYER_TYPE_HUMAN
+            || game->playerTypes[1] == PLAYER_TYPE_HUMAN) {
+        exit_game(ERROR_INVALID_PLAYER_TYPE);
+    }
+
+    int numThreads = options->batchThreads;
+    BatchWorker workers[numThreads];
+    pthread_t threads[numThreads];
+    Game start = *game;
+    initialise_game(&start, numTiles, tiles);
+
+    for (int i = 0; i < numThreads; i++) {
+        workers[i] = (BatchWorker) {options, &start, numTiles, tiles, i,
+                NULL, {0, 0}};
+        if (options->statsFile != NULL) {
+            workers[i].stats = create_stats(game->height, game->width,
+                    numTiles);
+        }
+        pthread_create(&threads[i], NULL, run_batch_thread, &workers[i]);
+    }
+
+    long wins[2] = {0, 0};
+    for (int i = 0; i < numThreads; i++) {
+        pthread_join(threads[i], NULL);
+        wins[0] += workers[i].wins[0];
+        wins[1] += workers[i].wins[1];
+        if (i > 0 && workers[i].stats != NULL) {
+            merge_stats(workers[0].stats, workers[i].stats);
+        }
+    }
+    release_game(&start);
+
+    printf("Player %c won %ld of %d games\n", PLAYER_SYMBOL(PLAYER_ONE),
+            wins[0], options->batchGames);
+    printf("Player %c won %ld of %d games\n", PLAYER_SYMBOL(PLAYER_TWO),
+            wins[1], options->batchGames);
+    if (options->statsFile != NULL) {
+        write_stats(workers[0].stats, options->statsFile);
+    }
+}
+
+/*
+ * Checks the tilefile is valid and returns how many tiles in file.
+ * See count_tiles for what a valid tilefile is.
+ *
+ * @param filename Path to tilefile to check
+ * @return Number of tiles in the tilefile
+ * @exit ERROR_TILEFILE_UNREADABLE if tilefile can't be read/opened
+ * @exit ERROR_TILEFILE_INVALID if tilefile is invalid
+ */
+int check_tilefile(char* filename) {
+    int numTiles = count_tiles(filename);
+    if (numTiles == TILEFILE_UNREADABLE) {
+        exit_game(ERROR_TILEFILE_UNREADABLE);
+    } else if (numTiles == TILEFILE_INVALID) {
+        exit_game(ERROR_TILEFILE_INVALID);
+    }
+
+    return numTiles;
+}
+
+/*
+ * Loads the game stored in its savefile. The savefile is memory mapped,
+ * checked with the same rules fitzcheck uses, and each row copied in one
+ * go. Also records the savefile's hash and size in case a journal follows
+ * it.
+ *
+ * @param game Game struct, with savefile set
+ * @param numTiles Number of tiles loaded from tilefile
+ * @exit ERROR_SAVEFILE_UNREADABLE if savefile can't be opened/read
+ * @exit ERROR_SAVEFILE_INVALID if savefile is invalid
+ */
+void load_savefile(Game* game, int numTiles) {
+    int fd = open(game->savefile, O_RDONLY);
+    struct stat info;
+    
+    if (fd == -1 || fstat(fd, &info) == -1) {
+        exit_game(ERROR_SAVEFILE_UNREADABLE);
+    }
+    
+    long size = info.st_size;
+    char* data = (size > 0)
+            ? mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0) : NULL;
+    close(fd);
+    if (data == MAP_FAILED) {
+        exit_game(ERROR_SAVEFILE_UNREADABLE);
+    }
+
+    Savefile save;
+    int line;
+    if (check_savefile_contents(data, size, numTiles, &save, &line)
+            != NULL) {
+        exit_game(ERROR_SAVEFILE_INVALID);
+    }
+    game->currentPlayer = save.currentPlayer;
+    game->currentTile = save.nextTile;
+    game->height = save.height;
+    game->width = save.width;
+
+    // Allocate memory for grid, then copy each row in after it
+    create_grid(game);
+    for (int row = 0; row < game->height; row++) {
+        memcpy(game->grid[row], save.grid + (long) row * (game->width + 1),
+                game->width);
+    }
+
+    game->delta.baseHash = hash_bytes(data, size);
+    game->delta.baseSize = size;
+    if (data != NULL) {
+        munmap(data, size);
+    }
+}
+
+/*
+ * Formats the game as the contents of a savefile.
+ *
+ * @param game Game struct
+ * @param size Destination to store length of savefile contents
+ * @return malloc'ed savefile contents (not null terminated)
+ */
+char* format_savefile(Game* game, long* size) {
+    char firstLine[INITIAL_BUFFER];
+
+    // First line contains next tile, player and dimensions
+    int lineLength = sprintf(firstLine, "%d %d %d %d\n", game->currentTile, 
+            game->currentPlayer, game->height, game->width);
+
+    *size = lineLength + (long) game->height * (game->width + 1);
+    char* contents = malloc(*size);
+    memcpy(contents, firstLine, lineLength);
+
+    char* pos = contents + lineLength;
+    for (int row = 0; row < game->height; row++) {
+        memcpy(pos, game->grid[row], game->width);
+        pos[game->width] = '\n';
+        pos += game->width + 1;
+    }
+
+    return contents;
+}
+
+/*
+ * Writes savefile to given file.
+ *
+ * @param filename Path to desired savefile location 
+ * @return true if write successful, false otherwise
+ */
+bool write_savefile(Game* game, char* filename) {
     FILE* file = fopen(filename, "w");
     
     if (file == NULL) {
         return false;
     }
     
-    // First line contains next tile, player and dimensions
-    fprintf(file, "%d %d %d %d\n", game->currentTile, 
-            game->currentPlayer, game->height, game->width);
+    long size;
+    char* contents = format_savefile(game, &size);
+    bool written = (fwrite(contents, 1, size, file) == size);
     
-    // Write grid
+    free(contents);
+    return (fclose(file) == 0) && written;
+}
+
+/*
+ * Saves the game to given file, incrementally if delta saves are enabled.
+ *
+ * @param game Game struct
+ * @param filename Path to desired savefile location
+ * @return true if save successful, false otherwise
+ */
+bool save_game(Game* game, char* filename) {
+    if (game->delta.enabled) {
+        return write_delta_savefile(game, filename);
+    }
+    return write_savefile(game, filename);
+}
+
+/*
+ * Hashes data with 32 bit FNV-1a. Used to tie a journal to its base.
+ *
+ * @param data Data to hash
+ * @param size Number of bytes in data
+ * @return Hash of data
+ */
+unsigned int hash_bytes(const char* data, long size) {
+    unsigned int hash = 2166136261u;
+
+    for (long i = 0; i < size; i++) {
+        hash ^= (unsigned char) data[i];
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+/*
+ * Gets path of the journal belonging to a savefile.
+ *
+ * @param filename Path of savefile
+ * @return malloc'ed path of journal
+ */
+char* get_journal_path(char* filename) {
+    char* path = malloc(strlen(filename) + strlen(JOURNAL_SUFFIX) + 1);
+
+    sprintf(path, "%s%s", filename, JOURNAL_SUFFIX);
+    return path;
+}
+
+/*
+ * Saves game as a base savefile plus a journal of moves made since.
+ *
+ * If filename is the current base and the journal is still smaller than the
+ * base, only the moves made since the last save are appended to the journal.
+ * Otherwise the journal is compacted: a full base savefile is written and
+ * a new empty journal started. The journal is FILENAME.journal and is laid
+ * out as a JOURNAL_HEADER_SIZE byte header, integers little endian:
+ *  - bytes 0-3: JOURNAL_MAGIC
+ *  - byte 4: JOURNAL_VERSION, bytes 5-7: unused
+ *  - bytes 8-11: FNV-1a hash of the base savefile
+ *  - bytes 12-15: size of the base savefile
+ *  - bytes 16-19: number of tiles in the tilefile
+ * followed by MOVELOG_RECORD_SIZE byte move records, as in move logs.
+ *
+ * @param game Game struct
+ * @param filename Path to desired savefile location
+ * @return true if save successful, false otherwise
+ */
+bool write_delta_savefile(Game* game, char* filename) {
+    DeltaSave* delta = &game->delta;
+
+    if (delta->base != NULL && strcmp(delta->base, filename) == 0
+            && delta->journal != NULL
+            && delta->journalSize < delta->baseSize) {
+        for (int i = 0; i < delta->numPending; i++) {
+            write_move_record(delta->journal, &delta->pending[i]);
+        }
+        delta->journalSize += (long) delta->numPending * MOVELOG_RECORD_SIZE;
+        delta->numPending = 0;
+        return fflush(delta->journal) == 0;
+    }
+
+    // Compact: write full base, then start an empty journal for it
+    if (delta->journal != NULL) {
+        fclose(delta->journal);
+        delta->journal = NULL;
+    }
+    free(delta->base);
+    delta->base = NULL;
+
+    long size;
+    char* contents = format_savefile(game, &size);
+    FILE* file = fopen(filename, "w");
+    bool written = (file != NULL && fwrite(contents, 1, size, file) == size);
+    if (file != NULL && fclose(file) != 0) {
+        written = false;
+    }
+    unsigned int hash = hash_bytes(contents, size);
+    free(contents);
+
+    char* journalPath = get_journal_path(filename);
+    delta->journal = written ? fopen(journalPath, "wb") : NULL;
+    free(journalPath);
+    if (delta->journal == NULL) {
+        return false;
+    }
+
+    unsigned char header[JOURNAL_HEADER_SIZE] = {0};
+    memcpy(header, JOURNAL_MAGIC, 4);
+    header[4] = JOURNAL_VERSION;
+    for (int i = 0; i < 4; i++) {
+        header[8 + i] = (hash >> (8 * i)) & 0xFF;
+        header[12 + i] = (size >> (8 * i)) & 0xFF;
+        header[16 + i] = (delta->numTiles >> (8 * i)) & 0xFF;
+    }
+    fwrite(header, 1, JOURNAL_HEADER_SIZE, delta->journal);
+
+    delta->base = strdup(filename);
+    delta->baseHash = hash;
+    delta->baseSize = size;
+    delta->journalSize = JOURNAL_HEADER_SIZE;
+    delta->numPending = 0;
+    return fflush(delta->journal) == 0;
+}
+
+/*
+ * Replays the journal of a delta saved savefile, if it has one, onto the
+ * grid already loaded from the savefile. Journals that don't belong to
+ * the savefile (e.g. since it was overwritten by a normal save) are ignored.
+ * Moves are trusted and applied without legality checks.
+ *
+ * If delta saves are enabled, later saves to the same savefile will
+ * continue appending to the journal.
+ *
+ * @param game Game struct with savefile grid loaded
+ * @param numTiles Number of tiles loaded from tilefile
+ * @param tiles Tiles loaded from tilefile
+ * @exit ERROR_SAVEFILE_INVALID if the journal is truncated mid move, was
+ *       written with a different tilefile or names a tile it doesn't have
+ */
+void load_savefile_journal(Game* game, int numTiles,
+        char tiles[numTiles][TILE_SIZE][TILE_SIZE]) {
+    char* journalPath = get_journal_path(game->savefile);
+    int fd = open(journalPath, O_RDONLY);
+    free(journalPath);
+    struct stat info;
+
+    if (fd == -1 || fstat(fd, &info) == -1
+            || info.st_size < JOURNAL_HEADER_SIZE) {
+        if (fd != -1) {
+            close(fd);
+        }
+        return;
+    }
+
+    long size = info.st_size;
+    unsigned char* data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        exit_game(ERROR_SAVEFILE_UNREADABLE);
+    }
+
+    unsigned int hash = 0;
+    long baseSize = 0;
+    long journalTiles = 0;
+    for (int i = 0; i < 4; i++) {
+        hash |= (unsigned int) data[8 + i] << (8 * i);
+        baseSize |= (long) data[12 + i] << (8 * i);
+        journalTiles |= (long) data[16 + i] << (8 * i);
+    }
+    if (memcmp(data, JOURNAL_MAGIC, 4) != 0 || data[4] != JOURNAL_VERSION
+            || hash != game->delta.baseHash
+            || baseSize != game->delta.baseSize) {
+        munmap(data, size);
+        return;
+    }
+    if (journalTiles != numTiles
+            || (size - JOURNAL_HEADER_SIZE) % MOVELOG_RECORD_SIZE != 0) {
+        exit_game(ERROR_SAVEFILE_INVALID);
+    }
+
+    for (long pos = JOURNAL_HEADER_SIZE; pos < size;
+            pos += MOVELOG_RECORD_SIZE) {
+        MoveRecord move;
+        read_move_record(data + pos, &move);
+        if (move.tile < 0 || move.tile >= numTiles) {
+            exit_game(ERROR_SAVEFILE_INVALID);
+        }
+
+        char tileRotation[TILE_SIZE][TILE_SIZE];
+        rotate_tile(tiles[move.tile], tileRotation, move.rotation);
+        game->currentPlayer = move.player;
+        place_tile(game, tileRotation, move.row, move.column, move.rotation);
+        game->currentPlayer = !move.player;
+        game->currentTile = (move.tile + 1) % numTiles;
+    }
+    munmap(data, size);
+
+    // Same as loading a plain savefile, no previous moves are known
+    game->numMoves = 0;
+
+    if (game->delta.enabled) {
+        journalPath = get_journal_path(game->savefile);
+        game->delta.journal = fopen(journalPath, "ab");
+        free(journalPath);
+        game->delta.base = strdup(game->savefile);
+        game->delta.journalSize = size;
+    }
+}
+
+/*
+ * Opens a move log for writing and writes its header.
+ *
+ * A move log begins with a MOVELOG_HEADER_SIZE byte header, all integers
+ * little endian:
+ *  - bytes 0-3: MOVELOG_MAGIC
+ *  - byte 4: MOVELOG_VERSION
+ *  - byte 5: flags (MOVELOG_FLAG_BASE_GRID if game started from a savefile)
+ *  - bytes 6-7, 8-9: grid height, grid width
+ *  - byte 10: player who moves first, byte 11: unused
+ *  - bytes 12-15: tile placed first
+ *  - bytes 16-19: number of tiles in the tilefile
+ * If the base grid flag is set, height * width grid cells follow.
+ * Every move is then appended as a MOVELOG_RECORD_SIZE byte record.
+ *
+ * @param game Game struct, after being initialised
+ * @param filename Path of move log to create
+ * @param numTiles Number of tiles loaded from tilefile
+ * @exit ERROR_MOVELOG_UNREADABLE if move log can't be opened
+ */
+void open_move_log(Game* game, char* filename, int numTiles) {
+    game->moveLog = fopen(filename, "wb");
+    if (game->moveLog == NULL) {
+        exit_game(ERROR_MOVELOG_UNREADABLE);
+    }
+
+    unsigned char header[MOVELOG_HEADER_SIZE] = {0};
+    memcpy(header, MOVELOG_MAGIC, 4);
+    header[4] = MOVELOG_VERSION;
+    header[5] = (game->savefile != NULL) ? MOVELOG_FLAG_BASE_GRID : 0;
+    header[6] = game->height & 0xFF;
+    header[7] = game->height >> 8;
+    header[8] = game->width & 0xFF;
+    header[9] = game->width >> 8;
+    header[10] = game->currentPlayer;
+    for (int i = 0; i < 4; i++) {
+        header[12 + i] = (game->currentTile >> (8 * i)) & 0xFF;
+        header[16 + i] = (numTiles >> (8 * i)) & 0xFF;
+    }
+    fwrite(header, 1, MOVELOG_HEADER_SIZE, game->moveLog);
+
+    if (game->savefile != NULL) {
+        for (int row = 0; row < game->height; row++) {
+            fwrite(game->grid[row], 1, game->width, game->moveLog);
+        }
+    }
+}
+
+/*
+ * Appends a single move to a move log. Rows and columns are stored as 16 bit
+ * signed integers, and the rotation and player share the final byte.
+ *
+ * @param file Move log stream to write to
+ * @param move Move to write
+ */
+void write_move_record(FILE* file, MoveRecord* move) {
+    unsigned char record[MOVELOG_RECORD_SIZE];
+
+    for (int i = 0; i < 4; i++) {
+        record[i] = (move->tile >> (8 * i)) & 0xFF;
+    }
+    record[4] = move->row & 0xFF;
+    record[5] = (move->row >> 8) & 0xFF;
+    record[6] = move->column & 0xFF;
+    record[7] = (move->column >> 8) & 0xFF;
+    record[8] = (move->rotation / 90) | (move->player << 2);
+
+    fwrite(record, 1, MOVELOG_RECORD_SIZE, file);
+}
+
+/*
+ * Decodes a single move from a move log record.
+ *
+ * @param data MOVELOG_RECORD_SIZE bytes of move log to decode
+ * @param move Destination to store decoded move
+ */
+void read_move_record(unsigned char* data, MoveRecord* move) {
+    move->tile = data[0] | (data[1] << 8) | (data[2] << 16)
+            | ((unsigned) data[3] << 24);
+    move->row = (short) (data[4] | (data[5] << 8));
+    move->column = (short) (data[6] | (data[7] << 8));
+    move->rotation = (data[8] & 3) * 90;
+    move->player = (data[8] >> 2) & 1;
+}
+
+/*
+ * Replays a move log and prints the resulting game in savefile format.
+ * All rotations of every tile are computed once, and moves are applied
+ * directly without legality checks. If verifyReplay is set, the whole log
+ * is first checked once to make sure each move is the legal placement of
+ * the expected tile by the expected player. Either way, a log that ends
+ * partway through a move or names a tile the tilefile doesn't have is
+ * rejected.
+ *
+ * @param options Options giving the move log and ply to replay to
+ * @param numTiles Number of tiles loaded from tilefile
+ * @param tiles Tiles loaded from tilefile
+ * @exit ERROR_MOVELOG_UNREADABLE if move log can't be opened/read
+ * @exit ERROR_MOVELOG_INVALID if move log is invalid or doesn't match tiles
+ */
+void replay_move_log(Options* options, int numTiles,
+        char tiles[numTiles][TILE_SIZE][TILE_SIZE]) {
+    FILE* file = fopen(options->replayFile, "rb");
+    if (file == NULL) {
+        exit_game(ERROR_MOVELOG_UNREADABLE);
+    }
+
+    // Read whole log in one go
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    unsigned char* data = malloc(size > 0 ? size : 1);
+    if (size < MOVELOG_HEADER_SIZE || fread(data, 1, size, file) != size) {
+        exit_game(ERROR_MOVELOG_INVALID);
+    }
+    fclose(file);
+
+    Game game;
+    memset(&game, 0, sizeof(Game));
+    game.height = data[6] | (data[7] << 8);
+    game.width = data[8] | (data[9] << 8);
+    int startPlayer = data[10];
+    int startTile = data[12] | (data[13] << 8) | (data[14] << 16)
+            | ((unsigned) data[15] << 24);
+    int logTiles = data[16] | (data[17] << 8) | (data[18] << 16)
+            | ((unsigned) data[19] << 24);
+    bool hasBase = data[5] & MOVELOG_FLAG_BASE_GRID;
+    long baseSize = hasBase ? (long) game.height * game.width : 0;
+
+    if (memcmp(data, MOVELOG_MAGIC, 4) != 0 || data[4] != MOVELOG_VERSION
+            || game.height < 1 || game.height > MAX_BOARD_SIZE
+            || game.width < 1 || game.width > MAX_BOARD_SIZE
+            || startPlayer > 1 || logTiles != numTiles
+            || startTile < 0 || startTile >= numTiles
+            || MOVELOG_HEADER_SIZE + baseSize > size) {
+        exit_game(ERROR_MOVELOG_INVALID);
+    }
+
+    unsigned char* base = data + MOVELOG_HEADER_SIZE;
+    unsigned char* records = base + baseSize;
+    int numRecords = (size - MOVELOG_HEADER_SIZE - baseSize)
+            / MOVELOG_RECORD_SIZE;
+    if ((size - MOVELOG_HEADER_SIZE - baseSize) % MOVELOG_RECORD_SIZE != 0) {
+        fprintf(stderr, "Move log truncated after ply %d\n", numRecords);
+        exit_game(ERROR_MOVELOG_INVALID);
+    }
+    int ply = options->replayPly;
+    if (ply == -1 || ply > numRecords) {
+        ply = numRecords;
+    }
+
+    char rotations[numTiles][4][TILE_SIZE][TILE_SIZE];
+    for (int tile = 0; tile < numTiles; tile++) {
+        for (int i = 0; i < 4; i++) {
+            rotate_tile(tiles[tile], rotations[tile][i], i * 90);
+        }
+    }
+
+    create_grid(&game);
+
+    // Verify pass runs over whole log, replay pass stops at ply
+    for (int pass = options->verifyReplay ? 0 : 1; pass < 2; pass++) {
+        int moves = (pass == 0) ? numRecords : ply;
+        game.currentPlayer = startPlayer;
+        game.currentTile = startTile;
+
+        for (int row = 0; row < game.height; row++) {
+            if (hasBase) {
+                memcpy(game.grid[row], base + (long) row * game.width,
+                        game.width);
+            } else {
+                memset(game.grid[row], EMPTY_GRID_CELL, game.width);
+            }
+        }
+
+        for (int i = 0; i < moves; i++) {
+            MoveRecord move;
+            read_move_record(records + (long) i * MOVELOG_RECORD_SIZE, &move);
+            if (move.tile < 0 || move.tile >= numTiles) {
+                fprintf(stderr, "Unknown tile at ply %d\n", i + 1);
+                exit_game(ERROR_MOVELOG_INVALID);
+            }
+            char (*tile)[TILE_SIZE] = rotations[move.tile][move.rotation / 90];
+
+            if (pass == 0 && (move.tile != game.currentTile
+                    || move.player != game.currentPlayer
+                    || !is_tile_placeable(&game, tile, move.row,
+                    move.column))) {
+                fprintf(stderr, "Illegal move at ply %d\n", i + 1);
+                exit_game(ERROR_MOVELOG_INVALID);
+            }
+
+            game.currentPlayer = move.player;
+            place_tile(&game, tile, move.row, move.column, move.rotation);
+            game.currentPlayer = !move.player;
+            game.currentTile = (move.tile + 1) % numTiles;
+        }
+    }
+
+    printf("%d %d %d %d\n", game.currentTile, game.currentPlayer,
+            game.height, game.width);
+    print_grid(&game);
+    free(data);
+}
+
+/*
+ * Compares placements by covered cells, then by order they were generated.
+ *
+ * @param a First placement
+ * @param b Second placement
+ * @return Negative, zero or positive as for qsort
+ */
+int compare_placements(const void* a, const void* b) {
+    const Placement* first = a;
+    const Placement* second = b;
+
+    if (first->mask != second->mask) {
+        return (first->mask < second->mask) ? -1 : 1;
+    }
+    // Same cells, so keep order rotation, then row, then column
+    if (first->rotation != second->rotation) {
+        return first->rotation - second->rotation;
+    }
+    if (first->row != second->row) {
+        return first->row - second->row;
+    }
+    return first->column - second->column;
+}
+
+/*
+ * Creates a solver for a board of at most SOLVER_MAX_CELLS cells.
+ * Every placement of each tile that keeps its cells on the board is turned
+ * into a bitboard once. Placements covering the same cells (from symmetric
+ * tiles) are only kept once, as the first in rotation, row, column order.
+ *
+ * @param height Height of the board
+ * @param width Width of the board
+ * @param numTiles Number of tiles loaded from tilefile
+ * @param tiles Tiles loaded from tilefile
+ * @param memory Megabytes to use for the position table
+ * @return malloc'ed solver
+ */
+Solver* create_solver(int height, int width, int numTiles,
+        char tiles[numTiles][TILE_SIZE][TILE_SIZE], int memory) {
+    Solver* solver = calloc(1, sizeof(Solver));
+    solver->height = height;
+    solver->width = width;
+    solver->numTiles = numTiles;
+    solver->numPlacements = calloc(numTiles, sizeof(int));
+    solver->placements = malloc(sizeof(Placement*) * numTiles);
+
+    int maxPlacements = 4 * (height + 4) * (width + 4);
+    for (int tile = 0; tile < numTiles; tile++) {
+        Placement* placements = malloc(sizeof(Placement) * maxPlacements);
+        int count = 0;
+
+        for (int theta = 0; theta <= 270; theta += 90) {
+            char tileRotation[TILE_SIZE][TILE_SIZE];
+            rotate_tile(tiles[tile], tileRotation, theta);
+
+            for (int row = -2; row < height + 2; row++) {
+                for (int column = -2; column < width + 2; column++) {
+                    unsigned long long mask = 0;
+                    bool onBoard = true;
+
+                    for (int i = 0; i < TILE_SIZE && onBoard; i++) {
+                        for (int j = 0; j < TILE_SIZE; j++) {
+                            int y = row - 2 + i, x = column - 2 + j;
+                            if (tileRotation[i][j] == EMPTY_TILE_CELL) {
+                                continue;
+                            }
+                            if (y < 0 || x < 0 || y >= height || x >= width) {
+                                onBoard = false;
+                                break;
+                            }
+                            mask |= 1ULL << (y * width + x);
+                        }
+                    }
+
+                    if (onBoard) {
+                        placements[count++] = (Placement) {mask, row, column,
+                                theta};
+                    }
+                }
+            }
+        }
+
+        // Remove placements covering the same cells
+        qsort(placements, count, sizeof(Placement), compare_placements);
+        int unique = 0;
+        for (int i = 0; i < count; i++) {
+            if (unique == 0
+                    || placements[unique - 1].mask != placements[i].mask) {
+                placements[unique++] = placements[i];
+            }
+        }
+
+        solver->placements[tile] = placements;
+        solver->numPlacements[tile] = unique;
+    }
+
+    // Largest power of two number of entries that fits in memory
+    unsigned long entries = 1;
+    while (entries * 2 * sizeof(SolverEntry) <= (unsigned long) memory << 20) {
+        entries *= 2;
+    }
+    solver->table = calloc(entries, sizeof(SolverEntry));
+    solver->tableMask = entries - 1;
+
+    return solver;
+}
+
+/*
+ * Gets bitboard of occupied cells of a small game grid.
+ *
+ * @param game Game struct, with at most SOLVER_MAX_CELLS cells
+ * @return Bitboard with bit (row * width + column) set if cell occupied
+ */
+unsigned long long get_occupied_cells(Game* game) {
+    unsigned long long occupied = 0;
+
+    for (int row = 0; row < game->height; row++) {
+        for (int column = 0; column < game->width; column++) {
+            if (game->grid[row][column] != EMPTY_GRID_CELL) {
+                occupied |= 1ULL << (row * game->width + column);
+            }
+        }
+    }
+
+    return occupied;
+}
+
+/*
+ * Determines whether the player to move wins a position with perfect play.
+ * A player loses when the tile they must place fits nowhere. Whose cells
+ * are whose never affects what can be placed, so positions are remembered
+ * by occupied cells and tile only, and shared between both players.
+ * Prints progress to stderr every SOLVER_REPORT_NODES positions.
+ * If the solver's deadline passes, sets timedOut and returns false without
+ * remembering any unfinished positions.
+ *
+ * @param solver Solver for the board
+ * @param occupied Bitboard of occupied cells
+ * @param tile Tile the player to move must place
+ * @param winningMove If not NULL, set to a winning placement if one exists
+ * @return true if the player to move wins, false otherwise
+ */
+bool solve_position(Solver* solver, unsigned long long occupied, int tile,
+        Placement** winningMove) {
+    if (++solver->nodes % SOLVER_REPORT_NODES == 0) {
+        fprintf(stderr, "Searched %llu positions, table %lu%% full\n",
+                solver->nodes,
+                solver->tableUsed * 100 / (solver->tableMask + 1));
+    }
+
+    // Mix bits of the position to pick a table slot
+    unsigned long long hash = mix_bits(occupied ^ mix_bits(tile + 1));
+    SolverEntry* entry = &solver->table[hash & solver->tableMask];
+
+    if (winningMove == NULL && entry->occupied == occupied
+            && entry->tile == tile + 1) {
+        return entry->moverWins;
+    }
+
+    if (solver->deadline != 0 && solver->nodes % DEADLINE_CHECK_NODES == 0
+            && get_clock_ns() >= solver->deadline) {
+        solver->timedOut = true;
+    }
+    if (solver->timedOut) {
+        return false;
+    }
+
+    bool moverWins = false;
+    int nextTile = (tile + 1) % solver->numTiles;
+    Placement* placements = solver->placements[tile];
+
+    for (int i = 0; i < solver->numPlacements[tile]; i++) {
+        if ((placements[i].mask & occupied) != 0) {
+            continue;
+        }
+        bool opponentWins = solve_position(solver,
+                occupied | placements[i].mask, nextTile, NULL);
+        // Unfinished searches mustn't be stored as results
+        if (solver->timedOut) {
+            return false;
+        }
+        if (!opponentWins) {
+            moverWins = true;
+            if (winningMove != NULL) {
+                *winningMove = &placements[i];
+            }
+            break;
+        }
+    }
+
+    solver->tableUsed += (entry->tile == 0);
+    entry->occupied = occupied;
+    entry->tile = tile + 1;
+    entry->moverWins = moverWins;
+    return moverWins;
+}
+
+/*
+ * Solves the game in a savefile and prints the winner with perfect play.
+ * If the player to move wins, also prints a winning move, in the same
+ * format as automatic players' moves.
+ *
+ * @param options Options giving the savefile and solver memory
+ * @param numTiles Number of tiles loaded from tilefile
+ * @param tiles Tiles loaded from tilefile
+ * @exit ERROR_SAVEFILE_UNREADABLE if savefile can't be open/read
+ * @exit ERROR_SAVEFILE_INVALID if savefile is invalid
+ * @exit ERROR_INVALID_DIMENSIONS if the board is too large to solve
+ */
+void solve_savefile(Options* options, int numTiles,
+        char tiles[numTiles][TILE_SIZE][TILE_SIZE]) {
+    Game game;
+    memset(&game, 0, sizeof(Game));
+    game.savefile = options->solveFile;
+    initialise_game(&game, numTiles, tiles);
+
+    if (game.height * game.width > SOLVER_MAX_CELLS) {
+        exit_game(ERROR_INVALID_DIMENSIONS);
+    }
+
+    Solver* solver = create_solver(game.height, game.width, numTiles, tiles,
+            options->solverMemory);
+    Placement* winningMove = NULL;
+    bool moverWins = solve_position(solver, get_occupied_cells(&game),
+            game.currentTile, &winningMove);
+
+    if (moverWins) {
+        printf("Player %c wins\n", PLAYER_SYMBOL(game.currentPlayer));
+        printf("Player %c => %d %d rotated %d\n",
+                PLAYER_SYMBOL(game.currentPlayer), winningMove->row,
+                winningMove->column, winningMove->rotation);
+    } else {
+        printf("Player %c wins\n", PLAYER_SYMBOL(!game.currentPlayer));
+    }
+}
+
+/*
+ * Makes a mobility player's move with the endgame solver, if few enough
+ * cells are left empty and the player has a winning move. The solver gives
+ * up at the game's move deadline, if there is one.
+ *
+ * @param game Game struct, with endgame solver
+ * @return true if a winning move was made and printed, false otherwise
+ */
+bool endgame_move(Game* game) {
+    Solver* solver = game->endgame;
+    unsigned long long occupied = get_occupied_cells(game);
+    int emptyCells = game->height * game->width
+            - __builtin_popcountll(occupied);
+
+    Placement* winningMove = NULL;
+    solver->deadline = game->deadline;
+    solver->timedOut = false;
+    if (emptyCells > solver->emptyCells || !solve_position(solver, occupied,
+            game->currentTile, &winningMove)) {
+        return false;
+    }
+
+    // Rebuild tile from its placement's cells so the grid can be updated
+    char tileRotation[TILE_SIZE][TILE_SIZE];
+    for (int i = 0; i < TILE_SIZE; i++) {
+        for (int j = 0; j < TILE_SIZE; j++) {
+            int y = winningMove->row - 2 + i, x = winningMove->column - 2 + j;
+            bool covered = y >= 0 && x >= 0 && y < game->height
+                    && x < game->width
+                    && (winningMove->mask >> (y * game->width + x)) & 1;
+            tileRotation[i][j] = covered ? OCCUPIED_TILE_CELL
+                    : EMPTY_TILE_CELL;
+        }
+    }
+
+    place_tile(game, tileRotation, winningMove->row, winningMove->column,
+            winningMove->rotation);
+    print_move(game);
+    return true;
+}
+
+/*
+ * Scrambles the bits of a 64 bit value (splitmix64 finaliser).
+ *
+ * @param value Value to scramble
+ * @return Scrambled value
+ */
+unsigned long long mix_bits(unsigned long long value) {
+    value += RANDOM_STATE_STEP;
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+    return value ^ (value >> 31);
+}
+
+/*
+ * Computes hash of the occupied cells of the grid from scratch. The hash is
+ * the XOR of mix_bits(row * width + column + 1) over every occupied cell,
+ * and is kept up to date by place_tile afterwards.
+ *
+ * @param game Game struct
+ * @return Hash of occupied cells
+ */
+unsigned long long get_position_hash(Game* game) {
+    unsigned long long hash = 0;
+
     for (int row = 0; row < game->height; row++) {
-        fprintf(file, "%s\n", game->grid[row]);
+        for (int column = 0; column < game->width; column++) {
+            if (game->grid[row][column] != EMPTY_GRID_CELL) {
+                hash ^= mix_bits((long) row * game->width + column + 1);
+            }
+        }
+    }
+
+    return hash;
+}
+
+/*
+ * Gets opening book key of a position. Never 0, which marks empty slots.
+ *
+ * @param positionHash Hash of the occupied cells of the position
+ * @param tile Tile to be placed next
+ * @return Book key of position
+ */
+unsigned long long get_book_key(unsigned long long positionHash, int tile) {
+    return mix_bits(positionHash ^ mix_bits(~(unsigned long long) tile)) | 1;
+}
+
+/*
+ * Finds the slot of an opening book a key is stored in, or would be stored
+ * in if added (linear probing).
+ *
+ * @param book Opening book
+ * @param key Key of position
+ * @return Slot with given key, or the empty slot it would go in
+ */
+BookEntry* find_book_entry(OpeningBook* book, unsigned long long key) {
+    unsigned long mask = book->header->numSlots - 1;
+    unsigned long slot = key & mask;
+
+    while (book->slots[slot].key != 0 && book->slots[slot].key != key) {
+        slot = (slot + 1) & mask;
+    }
+
+    return &book->slots[slot];
+}
+
+/*
+ * Adds best moves for a position and every position reachable from it
+ * in the given number of moves to an opening book. The best move is a
+ * winning move found by the solver, or the first placement if there is none.
+ * Positions already in the book (reached by transposition) are skipped.
+ *
+ * @param book Opening book being generated, with enough slots
+ * @param solver Solver for the board
+ * @param occupied Bitboard of occupied cells
+ * @param positionHash Hash of occupied cells, as from get_position_hash
+ * @param tile Tile to be placed next
+ * @param plies Number of moves left to add
+ */
+void generate_book_moves(OpeningBook* book, Solver* solver,
+        unsigned long long occupied, unsigned long long positionHash,
+        int tile, int plies) {
+    BookEntry* entry = find_book_entry(book, get_book_key(positionHash, tile));
+    if (plies == 0 || entry->key != 0) {
+        return;
+    }
+
+    Placement* best = NULL;
+    if (!solve_position(solver, occupied, tile, &best)) {
+        for (int i = 0; i < solver->numPlacements[tile]; i++) {
+            if ((solver->placements[tile][i].mask & occupied) == 0) {
+                best = &solver->placements[tile][i];
+                break;
+            }
+        }
+    }
+    if (best == NULL) {
+        return; // Game over, no move to store
+    }
+
+    *entry = (BookEntry) {get_book_key(positionHash, tile), best->row,
+            best->column, best->rotation};
+
+    for (int i = 0; i < solver->numPlacements[tile]; i++) {
+        unsigned long long mask = solver->placements[tile][i].mask;
+        if ((mask & occupied) != 0) {
+            continue;
+        }
+
+        unsigned long long childHash = positionHash;
+        for (unsigned long long cells = mask; cells != 0;
+                cells &= cells - 1) {
+            childHash ^= mix_bits(__builtin_ctzll(cells) + 1);
+        }
+        generate_book_moves(book, solver, occupied | mask, childHash,
+                (tile + 1) % solver->numTiles, plies - 1);
+    }
+}
+
+/*
+ * Generates an opening book of the best moves for the first bookPlies moves
+ * from an empty board, and writes it to a file. The file is a BookHeader
+ * followed by numSlots BookEntry slots, to be memory mapped when used.
+ *
+ * @param options Options giving book path, plies and solver memory
+ * @param height Height of board
+ * @param width Width of board
+ * @param numTiles Number of tiles loaded from tilefile
+ * @param tiles Tiles loaded from tilefile
+ * @exit ERROR_BOOK_INVALID if book can't be written
+ */
+void make_opening_book(Options* options, int height, int width,
+        int numTiles, char tiles[numTiles][TILE_SIZE][TILE_SIZE]) {
+    Solver* solver = create_solver(height, width, numTiles, tiles,
+            options->solverMemory);
+
+    // Upper bound on positions: every placement sequence of bookPlies moves
+    double positions = 1, plyPositions = 1;
+    for (int ply = 0; ply < options->bookPlies - 1; ply++) {
+        plyPositions *= solver->numPlacements[ply % numTiles];
+        positions += plyPositions;
+    }
+    unsigned long numSlots = 1;
+    while (numSlots < 2 * positions) {
+        numSlots *= 2;
+    }
+
+    BookHeader header = {BOOK_MAGIC, BOOK_VERSION, height, width, numTiles,
+            hash_bytes((char*) tiles, (long) numTiles * TILE_SIZE * TILE_SIZE),
+            numSlots};
+    OpeningBook book = {&header, calloc(numSlots, sizeof(BookEntry)), 0};
+    generate_book_moves(&book, solver, 0, 0, 0, options->bookPlies);
+
+    FILE* file = fopen(options->makeBookFile, "wb");
+    if (file == NULL || fwrite(&header, sizeof(BookHeader), 1, file) != 1
+            || fwrite(book.slots, sizeof(BookEntry), numSlots, file)
+            != numSlots || fclose(file) != 0) {
+        exit_game(ERROR_BOOK_INVALID);
+    }
+
+    unsigned long stored = 0;
+    for (unsigned long i = 0; i < numSlots; i++) {
+        stored += (book.slots[i].key != 0);
+    }
+    printf("Stored %lu positions after searching %llu\n", stored,
+            solver->nodes);
+}
+
+/*
+ * Memory maps an opening book for use by mobility players.
+ *
+ * @param filename Path of opening book
+ * @param game Game struct, after being initialised
+ * @param numTiles Number of tiles loaded from tilefile
+ * @param tiles Tiles loaded from tilefile
+ * @return malloc'ed opening book
+ * @exit ERROR_BOOK_INVALID if book can't be read, or is for another board
+ *       size or tilefile
+ */
+OpeningBook* load_opening_book(char* filename, Game* game, int numTiles,
+        char tiles[numTiles][TILE_SIZE][TILE_SIZE]) {
+    int fd = open(filename, O_RDONLY);
+    struct stat info;
+
+    if (fd == -1 || fstat(fd, &info) == -1
+            || info.st_size < sizeof(BookHeader)) {
+        exit_game(ERROR_BOOK_INVALID);
+    }
+
+    OpeningBook* book = malloc(sizeof(OpeningBook));
+    book->size = info.st_size;
+    book->header = mmap(NULL, book->size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (book->header == MAP_FAILED) {
+        exit_game(ERROR_BOOK_INVALID);
+    }
+    book->slots = (BookEntry*) (book->header + 1);
+
+    BookHeader* header = book->header;
+    unsigned int tilesHash = hash_bytes((char*) tiles,
+            (long) numTiles * TILE_SIZE * TILE_SIZE);
+    if (memcmp(header->magic, BOOK_MAGIC, 4) != 0
+            || header->version != BOOK_VERSION
+            || header->height != game->height || header->width != game->width
+            || header->numTiles != numTiles || header->tilesHash != tilesHash
+            || header->numSlots == 0
+            || (header->numSlots & (header->numSlots - 1)) != 0
+            || sizeof(BookHeader) + header->numSlots * sizeof(BookEntry)
+            != book->size) {
+        exit_game(ERROR_BOOK_INVALID);
+    }
+
+    return book;
+}
+
+/*
+ * Makes an automatic player's move from the opening book, if the current
+ * position is in it.
+ *
+ * @param game Game struct, with opening book
+ * @param tile Current tile to place on grid
+ * @return true if a book move was made and printed, false otherwise
+ */
+bool book_move(Game* game, char tile[TILE_SIZE][TILE_SIZE]) {
+    BookEntry* entry = find_book_entry(game->book,
+            get_book_key(game->positionHash, game->currentTile));
+    if (entry->key == 0) {
+        return false;
+    }
+
+    char tileRotation[TILE_SIZE][TILE_SIZE];
+    rotate_tile(tile, tileRotation, entry->rotation);
+    // Guard against the (unlikely) case of two positions sharing a key
+    if (!is_tile_placeable(game, tileRotation, entry->row, entry->column)) {
+        return false;
+    }
+
+    place_tile(game, tileRotation, entry->row, entry->column,
+            entry->rotation);
+    print_move(game);
+    return true;
+}
+
+/*
+ * Counts legal placements of every tile and rotation on the current grid.
+ * After this, place_tile keeps the counts up to date.
+ *
+ * @param game Game struct, after being initialised
+ * @param numTiles Number of tiles loaded from tilefile
+ * @param tiles Tiles loaded from tilefile
+ * @return malloc'ed mobility counts
+ */
+Mobility* create_mobility(Game* game, int numTiles,
+        char tiles[numTiles][TILE_SIZE][TILE_SIZE]) {
+    Mobility* mobility = malloc(sizeof(Mobility));
+    mobility->numTiles = numTiles;
+    mobility->rotations = malloc(sizeof(*mobility->rotations) * numTiles);
+    mobility->counts = calloc(numTiles, sizeof(*mobility->counts));
+
+    for (int tile = 0; tile < numTiles; tile++) {
+        for (int i = 0; i < 4; i++) {
+            char (*rotation)[TILE_SIZE] = mobility->rotations[tile][i];
+            rotate_tile(tiles[tile], rotation, i * 90);
+
+            for (int row = -2; row < game->height + 2; row++) {
+                for (int column = -2; column < game->width + 2; column++) {
+                    if (is_tile_placeable(game, rotation, row, column)) {
+                        mobility->counts[tile][i]++;
+                    }
+                }
+            }
+        }
+    }
+
+    return mobility;
+}
+
+/*
+ * Counts placements of a tile that are legal now, but would no longer be
+ * legal after placing another tile (because they share a covered cell).
+ *
+ * @param game Game struct, with mobility counts
+ * @param tile Tile to count placements of
+ * @param placed Tile (already rotated) that would be placed
+ * @param row Row where middle of placed tile would be
+ * @param column Column where middle of placed tile would be
+ * @param blocked If not NULL, stores count for each rotation of tile
+ * @return Total blocked placements over all rotations of tile
+ */
+long count_blocked_placements(Game* game, int tile,
+        char placed[TILE_SIZE][TILE_SIZE], int row, int column,
+        long blocked[4]) {
+    long total = 0;
+
+    for (int i = 0; i < 4; i++) {
+        char (*rotation)[TILE_SIZE] = game->mobility->rotations[tile][i];
+        long count = 0;
+
+        // Only placements centred within TILE_SIZE - 1 can share a cell
+        for (int y = row - TILE_SIZE + 1; y < row + TILE_SIZE; y++) {
+            for (int x = column - TILE_SIZE + 1; x < column + TILE_SIZE;
+                    x++) {
+                bool overlaps = false;
+
+                for (int a = 0; a < TILE_SIZE && !overlaps; a++) {
+                    for (int b = 0; b < TILE_SIZE; b++) {
+                        // Cell of this placement, relative to placed tile
+                        int placedRow = y - row + a;
+                        int placedColumn = x - column + b;
+                        if (rotation[a][b] != EMPTY_TILE_CELL
+                                && placedRow >= 0 && placedRow < TILE_SIZE
+                                && placedColumn >= 0
+                                && placedColumn < TILE_SIZE
+                                && placed[placedRow][placedColumn]
+                                != EMPTY_TILE_CELL) {
+                            overlaps = true;
+                            break;
+                        }
+                    }
+                }
+
+                if (overlaps && is_tile_placeable(game, rotation, y, x)) {
+                    count++;
+                }
+            }
+        }
+
+        if (blocked != NULL) {
+            blocked[i] = count;
+        }
+        total += count;
     }
-    
-    fclose(file);
-    return true;
+
+    return total;
 }
 
 /*
- * Rotates given tile specified number of degrees and stores it in destTile
- * If given degrees is 0, tile be copied to destTile
+ * Updates mobility counts for a tile about to be placed. Must be called
+ * before the placed tile's cells are written to the grid.
  *
- * @param tile Original tile to be rotated
- * @param destTile Destination where rotated tile will be stored
- * @param degrees Number of degrees to rotate (divisible by 90).
+ * @param game Game struct, with mobility counts
+ * @param placed Tile (already rotated) being placed
+ * @param row Row where middle of placed tile will be
+ * @param column Column where middle of placed tile will be
  */
-void rotate_tile(char tile[TILE_SIZE][TILE_SIZE], 
-        char destTile[TILE_SIZE][TILE_SIZE], int degrees) {
-            
-    int numRotations = degrees / 90;
-    
-    char tempTile[TILE_SIZE][TILE_SIZE];
-    
-    // Copy tile to destTile. Used for if degrees == 0
-    for (int i = 0; i < TILE_SIZE; i++) {
-        for (int j = 0; j < TILE_SIZE; j++) {
-            destTile[i][j] = tile[i][j];
-        }            
-    }
+void update_mobility(Game* game, char placed[TILE_SIZE][TILE_SIZE],
+        int row, int column) {
+    for (int tile = 0; tile < game->mobility->numTiles; tile++) {
+        long blocked[4];
+        count_blocked_placements(game, tile, placed, row, column, blocked);
 
-    for (int iteration = 0; iteration < numRotations; iteration++) {
-        // Copy tile to a temp location array.
-        // This allows for rotation multiple times.
-        for (int i = 0; i < TILE_SIZE; i++) {
-            for (int j = 0; j < TILE_SIZE; j++) {
-                tempTile[i][j] = destTile[i][j];
-            }            
-        }
-        
-        // Rotate tempTile 90 degrees and store in destTIle
-        for (int i = 0; i < TILE_SIZE; i++) {
-            for (int j = 0; j < TILE_SIZE; j++) {
-                destTile[i][j] = tempTile[(TILE_SIZE - 1) - j][i];
-            }
+        for (int i = 0; i < 4; i++) {
+            game->mobility->counts[tile][i] -= blocked[i];
         }
     }
 }
 
+/*
+ * Gets number of legal placements of a tile, over all rotations.
+ *
+ * @param game Game struct, with mobility counts
+ * @param tile Tile to get number of placements for
+ * @return Number of legal (position, rotation) placements of tile
+ */
+long get_mobility(Game* game, int tile) {
+    long (*counts)[4] = game->mobility->counts;
+
+    return counts[tile][0] + counts[tile][1] + counts[tile][2]
+            + counts[tile][3];
+}
+
 /*
  * Checks whether the given tile is validly placeable on the board
  * at the given row and column.
@@ -525,7 +2601,8 @@ bool is_tile_placeable(Game* game, char tile[TILE_SIZE][TILE_SIZE],
 
 /*
  * Determines whether the game is over for the current player.
- * Checks every possible move to be made on board with given tile.
+ * Checks every possible move to be made on board with given tile, and
+ * remembers the first legal one found as the game's fallback move.
  *
  * @param game Game struct
  * @param tile Next tile that needs to be placed
@@ -533,6 +2610,30 @@ bool is_tile_placeable(Game* game, char tile[TILE_SIZE][TILE_SIZE],
  */
 bool is_game_over(Game* game, char tile[TILE_SIZE][TILE_SIZE]) {
     char rotations[4][TILE_SIZE][TILE_SIZE];
+    unsigned int masks[TILE_SIZE];
+
+    if (game->pool != NULL
+            && (long) game->height * game->width >= SEARCH_POOL_MIN_CELLS) {
+        int bounds[4] = {-2, game->height + 2, -2, game->width + 2};
+        return parallel_first_fit(game, tile, SEARCH_ROTATIONS_INNER, bounds,
+                -2, -2, 0, &game->fallback) == SEARCH_NONE;
+    }
+    if (game->views != NULL) {
+        get_tile_masks(tile, masks);
+        for (int row = -2; row <= game->height + 2; row++) {
+            for (int column = -2; column <= game->width + 2; column++) {
+                for (int curRotation = 0; curRotation < 4; curRotation++) {
+                    if (is_view_placeable(game->views, masks, row, column,
+                            curRotation)) {
+                        game->fallback = (PreviousMove) {row, column,
+                                curRotation * 90};
+                        return false;
+                    }
+                }
+            }
+        }
+        return true;
+    }
     
     rotate_tile(tile, rotations[0], 0);
     rotate_tile(tile, rotations[1], 90);
@@ -546,52 +2647,633 @@ bool is_game_over(Game* game, char tile[TILE_SIZE][TILE_SIZE]) {
             for (int curRotation = 0; curRotation < 4; curRotation++) {
                 if (is_tile_placeable(game, rotations[curRotation], 
                         row, column)) {
+                    game->fallback = (PreviousMove) {row, column,
+                            curRotation * 90};
                     return false; // Tile can be placed, game not over
                 }
             }
         }
     }
 
-    return true;
+    return true;
+}
+
+/*
+ * Places given tile on game grid and updates the last play information.
+ * Assumes given tile and coordinates is a valid placement.
+ *
+ * @param game Game struct
+ * @param tile Tile to be placed on board
+ * @param row Row where middle of tile will be placed (starting at 0)
+ * @param column Column where middle of tile will be placed (starting at 0)
+ * @param rotation Degrees the tile was rotated by before placing
+ */
+void place_tile(Game* game, char tile[TILE_SIZE][TILE_SIZE], 
+        int row, int column, int rotation) {
+            
+    if (game->mobility != NULL) {
+        update_mobility(game, tile, row, column);
+    }
+    make_rows_writable(game, row - 2, row + 2);
+
+    for (int i = 0; i < TILE_SIZE; i++) {
+        for (int j = 0; j < TILE_SIZE; j++) {
+            // Translate cell in tile to location it will be placed on grid.
+            int xCord = (column - 2) + j;
+            int yCord = (row - 2) + i;
+            
+            char tileCell = tile[i][j];
+            
+            // Tile cell isn't being placed on board
+            if (xCord < 0 || yCord < 0 || xCord >= game->width 
+                    || yCord >= game->height) {
+                continue;
+            }
+            
+            // Only copy over non-empty tile cells
+            if (tileCell != EMPTY_TILE_CELL) {
+                if (game->grid[yCord][xCord] == EMPTY_GRID_CELL) {
+                    game->positionHash ^= mix_bits(
+                            (long) yCord * game->width + xCord + 1);
+                }
+                game->grid[yCord][xCord] = PLAYER_SYMBOL(game->currentPlayer); 
+                if (game->views != NULL) {
+                    set_view_cell(game->views, yCord, xCord);
+                }
+            }
+            
+        }
+    } 
+    
+    game->dirtyTop = (row - 2 < 0) ? 0 : row - 2;
+    game->dirtyBottom = (row + 2 >= game->height) ? game->height - 1 : row + 2;
+    game->lastPlay[game->currentPlayer].row = row;
+    game->lastPlay[game->currentPlayer].column = column;
+    game->lastPlay[game->currentPlayer].rotation = rotation;
+    game->numMoves = game->numMoves + 1;
+}
+
+/*
+ * Finds the occupied cells of a (rotated) tile and how far they reach from
+ * its centre. An empty tile is given the bounds of a tile whose centre
+ * can go anywhere is_tile_placeable allows.
+ *
+ * @param tile Tile to find occupied cells of
+ * @param shape Destination to store occupied cells in
+ */
+void get_tile_shape(char tile[TILE_SIZE][TILE_SIZE], TileShape* shape) {
+    shape->numCells = 0;
+    shape->top = shape->left = TILE_SIZE / 2;
+    shape->bottom = shape->right = -(TILE_SIZE / 2);
+
+    for (int i = 0; i < TILE_SIZE; i++) {
+        for (int j = 0; j < TILE_SIZE; j++) {
+            if (tile[i][j] == EMPTY_TILE_CELL) {
+                continue;
+            }
+            int row = i - TILE_SIZE / 2, column = j - TILE_SIZE / 2;
+            shape->rows[shape->numCells] = row;
+            shape->columns[shape->numCells++] = column;
+            shape->top = (row < shape->top) ? row : shape->top;
+            shape->bottom = (row > shape->bottom) ? row : shape->bottom;
+            shape->left = (column < shape->left) ? column : shape->left;
+            shape->right = (column > shape->right) ? column : shape->right;
+        }
+    }
+}
+
+/*
+ * Generates every legal placement of a tile centred on the given row, in
+ * column then rotation order. Only columns where the whole tile is on the
+ * grid are tried, so each placement just checks its occupied cells.
+ *
+ * @param game Game struct
+ * @param shapes Shape of the tile at each rotation (0, 90, 180, 270)
+ * @param row Row the tile's centre is placed on
+ * @param moves Destination for legal placements, with room for
+ *        4 * (width + 4) of them
+ * @return Number of legal placements stored in moves
+ */
+int generate_row_moves(Game* game, TileShape shapes[4], int row,
+        PreviousMove* moves) {
+    int numMoves = 0;
+
+    for (int column = -2; column <= game->width + 1; column++) {
+        for (int rotation = 0; rotation < 4; rotation++) {
+            TileShape* shape = &shapes[rotation];
+            if (row + shape->top < 0 || row + shape->bottom >= game->height
+                    || column + shape->left < 0
+                    || column + shape->right >= game->width) {
+                continue;
+            }
+
+            bool placeable = true;
+            for (int i = 0; i < shape->numCells && placeable; i++) {
+                placeable = game->grid[row + shape->rows[i]]
+                        [column + shape->columns[i]] == EMPTY_GRID_CELL;
+            }
+            if (placeable) {
+                moves[numMoves++] = (PreviousMove) {row, column,
+                        rotation * 90};
+            }
+        }
+    }
+
+    return numMoves;
+}
+
+/*
+ * Allocates board views of the game's current grid.
+ * After this, place_tile keeps the views up to date.
+ *
+ * @param game Game struct, after being initialised
+ * @return malloc'ed board views
+ */
+BoardViews* create_views(Game* game) {
+    BoardViews* views = malloc(sizeof(BoardViews));
+
+    for (int k = 0; k < 4; k++) {
+        // Views turned a quarter turn have the grid's sides swapped
+        views->heights[k] = (k % 2 == 0) ? game->height : game->width;
+        views->widths[k] = (k % 2 == 0) ? game->width : game->height;
+        views->rowWords[k] = (views->widths[k] + 2 * VIEW_PADDING + 63) / 64;
+
+        // Every padded cell starts occupied, then the grid is cleared out
+        int paddedHeight = views->heights[k] + 2 * VIEW_PADDING;
+        long numWords = (long) paddedHeight * views->rowWords[k];
+        views->bits[k] = malloc(sizeof(unsigned long long) * numWords);
+        memset(views->bits[k], 0xff, sizeof(unsigned long long) * numWords);
+
+        for (int row = 0; row < views->heights[k]; row++) {
+            unsigned long long* bits = views->bits[k]
+                    + (long) (row + VIEW_PADDING) * views->rowWords[k];
+            for (int column = 0; column < views->widths[k]; column++) {
+                int x = column + VIEW_PADDING;
+                bits[x / 64] &= ~(1ULL << (x % 64));
+            }
+        }
+    }
+
+    for (int row = 0; row < game->height; row++) {
+        for (int column = 0; column < game->width; column++) {
+            if (game->grid[row][column] != EMPTY_GRID_CELL) {
+                set_view_cell(views, row, column);
+            }
+        }
+    }
+
+    return views;
+}
+
+/*
+ * Frees board views.
+ *
+ * @param views Board views to free
+ */
+void free_views(BoardViews* views) {
+    for (int k = 0; k < 4; k++) {
+        free(views->bits[k]);
+    }
+    free(views);
+}
+
+/*
+ * Marks a grid cell as occupied in every board view.
+ *
+ * @param views Board views
+ * @param row Row of the grid cell
+ * @param column Column of the grid cell
+ */
+void set_view_cell(BoardViews* views, int row, int column) {
+    int height = views->heights[0], width = views->widths[0];
+    // Where the cell ends up once the grid is turned k quarter turns
+    int rows[4] = {row, width - 1 - column, height - 1 - row, column};
+    int columns[4] = {column, row, width - 1 - column, height - 1 - row};
+
+    for (int k = 0; k < 4; k++) {
+        int x = columns[k] + VIEW_PADDING;
+        views->bits[k][(long) (rows[k] + VIEW_PADDING) * views->rowWords[k]
+                + x / 64] |= 1ULL << (x % 64);
+    }
+}
+
+/*
+ * Finds the occupied cells in each row of an unrotated tile.
+ *
+ * @param tile Tile to find row masks of
+ * @param masks Destination for each row's mask. Bit j is set if column j
+ *        of the row is occupied.
+ */
+void get_tile_masks(char tile[TILE_SIZE][TILE_SIZE],
+        unsigned int masks[TILE_SIZE]) {
+    for (int i = 0; i < TILE_SIZE; i++) {
+        masks[i] = 0;
+        for (int j = 0; j < TILE_SIZE; j++) {
+            if (tile[i][j] != EMPTY_TILE_CELL) {
+                masks[i] |= 1U << j;
+            }
+        }
+    }
+}
+
+/*
+ * Checks whether a tile can be placed on the grid at the given rotation,
+ * the same as is_tile_placeable would with the rotated tile, by placing
+ * the unrotated tile on the board view for that rotation.
+ *
+ * @param views Board views of the grid
+ * @param masks Row masks of the unrotated tile, from get_tile_masks
+ * @param row Row where middle of tile will be placed (starting at 0)
+ * @param column Column where middle of tile will be placed (starting at 0)
+ * @param rotation Number of quarter turns the tile is rotated by (0 to 3)
+ * @return true if valid placement, false otherwise
+ */
+bool is_view_placeable(BoardViews* views, unsigned int masks[TILE_SIZE],
+        int row, int column, int rotation) {
+    int height = views->heights[0], width = views->widths[0];
+    if (column >= width + 2 || row >= height + 2 || column < -2
+            || row < -2) {
+        return false;
+    }
+
+    // Move the tile's centre to where it is on the turned grid
+    int rows[4] = {row, width - 1 - column, height - 1 - row, column};
+    int columns[4] = {column, row, width - 1 - column, height - 1 - row};
+    int x = columns[rotation] - 2 + VIEW_PADDING;
+    int word = x / 64, shift = x % 64;
+    int rowWords = views->rowWords[rotation];
+    unsigned long long* bits = views->bits[rotation]
+            + (long) (rows[rotation] - 2 + VIEW_PADDING) * rowWords + word;
+
+    for (int i = 0; i < TILE_SIZE; i++, bits += rowWords) {
+        if (masks[i] == 0) {
+            continue;
+        }
+        unsigned long long cells = bits[0] >> shift;
+        if (shift > 64 - TILE_SIZE) {
+            cells |= bits[1] << (64 - shift);
+        }
+        if (cells & masks[i]) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*
+ * Starts a pool of threads that is_game_over and the type one auto player
+ * share large first-fit searches with. The thread making a search works
+ * on it too, so numThreads - 1 threads are started.
+ *
+ * @param numThreads Number of threads to search with
+ * @return malloc'ed search pool, used for the rest of the program
+ */
+SearchPool* create_search_pool(int numThreads) {
+    SearchPool* pool = calloc(1, sizeof(SearchPool));
+    pool->numThreads = numThreads;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->started, NULL);
+    pthread_cond_init(&pool->finished, NULL);
+
+    for (int i = 1; i < numThreads; i++) {
+        pthread_t thread;
+        pthread_create(&thread, NULL, run_search_thread, pool);
+        pthread_detach(thread);
+    }
+
+    return pool;
+}
+
+/*
+ * Waits for searches to be started on the pool and helps with each one.
+ *
+ * @param arg SearchPool this thread belongs to
+ * @return Never returns
+ */
+void* run_search_thread(void* arg) {
+    SearchPool* pool = (SearchPool*) arg;
+    long seen = 0;
+
+    while (true) {
+        pthread_mutex_lock(&pool->lock);
+        while (pool->generation == seen) {
+            pthread_cond_wait(&pool->started, &pool->lock);
+        }
+        seen = pool->generation;
+        FitSearch* search = pool->search;
+        pthread_mutex_unlock(&pool->lock);
+
+        search_chunks(search);
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->busy == 0) {
+            pthread_cond_signal(&pool->finished);
+        }
+        pthread_mutex_unlock(&pool->lock);
+    }
+
+    return NULL;
+}
+
+/*
+ * Checks the placement at a position in a search's scan order.
+ *
+ * @param search Search being made
+ * @param index Position in scan order
+ * @param move Set to the placement at index
+ * @return true if the placement is legal, false otherwise
+ */
+bool is_search_placeable(FitSearch* search, long index, PreviousMove* move) {
+    long position;
+    int rotation;
+    if (search->order == SEARCH_ROTATIONS_INNER) {
+        position = index / 4;
+        rotation = index % 4;
+    } else {
+        position = index % search->numPositions;
+        rotation = index / search->numPositions;
+    }
+    position = (search->startOffset + position) % search->numPositions;
+    move->row = search->rowLow + position / search->columns;
+    move->column = search->columnLow + position % search->columns;
+    move->rotation = rotation * 90;
+
+    if (search->game->views != NULL) {
+        return is_view_placeable(search->game->views, search->masks,
+                move->row, move->column, rotation);
+    }
+    return is_tile_placeable(search->game, search->rotations[rotation],
+            move->row, move->column);
+}
+
+/*
+ * Takes chunks of a search in scan order until there are none left, or
+ * every chunk left comes after a legal placement another thread found.
+ * Each chunk stops at its first legal placement, and search->found is
+ * lowered to it if it's earlier than any found so far, so the result is
+ * the first in scan order however chunks are shared out.
+ *
+ * @param search Search being made
+ */
+void search_chunks(FitSearch* search) {
+    long total = 4 * search->numPositions;
+
+    while (true) {
+        long chunk = __atomic_fetch_add(&search->nextChunk, 1,
+                __ATOMIC_RELAXED);
+        long start = chunk * search->chunkSize;
+        if (start >= total
+                || start >= __atomic_load_n(&search->found, __ATOMIC_ACQUIRE)
+                || __atomic_load_n(&search->timedOut, __ATOMIC_RELAXED)) {
+            return;
+        }
+        if (search->deadline != 0 && get_clock_ns() >= search->deadline) {
+            __atomic_store_n(&search->timedOut, true, __ATOMIC_RELAXED);
+            return;
+        }
+
+        long end = (start + search->chunkSize < total)
+                ? start + search->chunkSize : total;
+        for (long index = start; index < end; index++) {
+            // Give up on this chunk once an earlier placement is found
+            if (index % search->columns == 0 && index >= __atomic_load_n(
+                    &search->found, __ATOMIC_ACQUIRE)) {
+                break;
+            }
+
+            PreviousMove move;
+            if (!is_search_placeable(search, index, &move)) {
+                continue;
+            }
+            long found = __atomic_load_n(&search->found, __ATOMIC_ACQUIRE);
+            while (index < found && !__atomic_compare_exchange_n(
+                    &search->found, &found, index, false, __ATOMIC_ACQ_REL,
+                    __ATOMIC_ACQUIRE)) {
+                // found is reloaded by a failed exchange
+            }
+            break;
+        }
+    }
+}
+
+/*
+ * Finds the first legal placement of a tile in scan order, sharing the
+ * search between the game's search pool. Positions are scanned in row
+ * major order over the given rows and columns, wrapping around from the
+ * start position, with rotations either tried at each position
+ * (SEARCH_ROTATIONS_INNER) or one after another over every position
+ * (SEARCH_ROTATIONS_OUTER).
+ *
+ * @param game Game struct, with a search pool
+ * @param tile Tile to place (unrotated)
+ * @param order SEARCH_ROTATIONS_INNER or SEARCH_ROTATIONS_OUTER
+ * @param bounds Lowest row, highest row, lowest column and highest column
+ * @param rowStart Row to start scanning from
+ * @param columnStart Column to start scanning from
+ * @param deadline Monotonic clock time (ns) to give up by, or 0
+ * @param move Set to the first legal placement, if there is one
+ * @return SEARCH_FOUND, SEARCH_NONE or SEARCH_TIMED_OUT
+ */
+int parallel_first_fit(Game* game, char tile[TILE_SIZE][TILE_SIZE],
+        int order, int bounds[4], int rowStart, int columnStart,
+        long long deadline, PreviousMove* move) {
+    SearchPool* pool = game->pool;
+    char rotations[4][TILE_SIZE][TILE_SIZE];
+    unsigned int masks[TILE_SIZE];
+    for (int i = 0; i < 4; i++) {
+        rotate_tile(tile, rotations[i], i * 90);
+    }
+    get_tile_masks(tile, masks);
+
+    FitSearch search = {.game = game, .rotations = rotations,
+            .masks = masks, .order = order, .rowLow = bounds[0],
+            .columnLow = bounds[2], .columns = bounds[3] - bounds[2] + 1,
+            .deadline = deadline};
+    search.numPositions = (long) (bounds[1] - bounds[0] + 1)
+            * search.columns;
+    search.startOffset = (long) (rowStart - bounds[0]) * search.columns
+            + columnStart - bounds[2];
+    search.chunkSize = 4L * search.columns * SEARCH_CHUNK_ROWS;
+    search.found = LONG_MAX;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->search = &search;
+    pool->busy = pool->numThreads - 1;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->started);
+    pthread_mutex_unlock(&pool->lock);
+
+    search_chunks(&search);
+
+    pthread_mutex_lock(&pool->lock);
+    while (pool->busy > 0) {
+        pthread_cond_wait(&pool->finished, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    // Chunks skipped after the deadline might have held an earlier placement
+    if (search.timedOut) {
+        return SEARCH_TIMED_OUT;
+    } else if (search.found == LONG_MAX) {
+        return SEARCH_NONE;
+    }
+    is_search_placeable(&search, search.found, move);
+    return SEARCH_FOUND;
+}
+
+/*
+ * Allocates a grid for the game's height and width, split into pages of
+ * GRID_PAGE_ROWS rows that aren't shared with any other game.
+ * Rows are null terminated, but their contents are left uninitialised.
+ *
+ * @param game Game struct with height and width set
+ */
+void create_grid(Game* game) {
+    int rowSize = game->width + 1;
+
+    game->numPages = (game->height + GRID_PAGE_ROWS - 1) / GRID_PAGE_ROWS;
+    game->pages = malloc(sizeof(GridPage*) * game->numPages);
+    game->grid = malloc(sizeof(char*) * game->height);
+
+    for (int page = 0; page < game->numPages; page++) {
+        game->pages[page] = malloc(sizeof(GridPage));
+        game->pages[page]->refs = 1;
+        game->pages[page]->cells = malloc(GRID_PAGE_ROWS * rowSize);
+    }
+    for (int row = 0; row < game->height; row++) {
+        game->grid[row] = game->pages[row / GRID_PAGE_ROWS]->cells
+                + (row % GRID_PAGE_ROWS) * rowSize;
+        game->grid[row][game->width] = '\0';
+    }
+}
+
+/*
+ * Creates a snapshot of the game's current position, sharing the game's
+ * grid pages rather than copying them. Pages are only copied when either
+ * game places a tile on them, so every batch game can start from one
+ * shared position cheaply. The snapshot doesn't log, save or keep
+ * mobility counts or board views, and doesn't use the (single threaded)
+ * endgame solver or the search pool.
+ *
+ * @param game Game to take snapshot of
+ * @param snapshot Game struct to fill in, released with release_game
+ */
+void fork_game(Game* game, Game* snapshot) {
+    *snapshot = *game;
+    snapshot->moveLog = NULL;
+    memset(&snapshot->delta, 0, sizeof(DeltaSave));
+    snapshot->endgame = NULL;
+    snapshot->mobility = NULL;
+    snapshot->views = NULL;
+    snapshot->pool = NULL;
+
+    snapshot->pages = malloc(sizeof(GridPage*) * game->numPages);
+    memcpy(snapshot->pages, game->pages, sizeof(GridPage*) * game->numPages);
+    for (int page = 0; page < game->numPages; page++) {
+        __atomic_add_fetch(&game->pages[page]->refs, 1, __ATOMIC_RELAXED);
+    }
+
+    snapshot->grid = malloc(sizeof(char*) * game->height);
+    memcpy(snapshot->grid, game->grid, sizeof(char*) * game->height);
+}
+
+/*
+ * Frees a game's grid, dropping its references to any shared pages.
+ *
+ * @param game Game (usually a snapshot) whose grid is no longer needed
+ */
+void release_game(Game* game) {
+    for (int page = 0; page < game->numPages; page++) {
+        if (__atomic_sub_fetch(&game->pages[page]->refs, 1,
+                __ATOMIC_ACQ_REL) == 0) {
+            free(game->pages[page]->cells);
+            free(game->pages[page]);
+        }
+    }
+    free(game->pages);
+    free(game->grid);
+    game->pages = NULL;
+    game->grid = NULL;
+    game->numPages = 0;
+}
+
+/*
+ * Makes sure the given rows of the grid can be written to without changing
+ * any other game's grid, by taking a private copy of any shared pages.
+ *
+ * @param game Game struct
+ * @param top First row about to be written (may be off the grid)
+ * @param bottom Last row about to be written (may be off the grid)
+ */
+void make_rows_writable(Game* game, int top, int bottom) {
+    int rowSize = game->width + 1;
+    top = (top < 0) ? 0 : top;
+    bottom = (bottom >= game->height) ? game->height - 1 : bottom;
+
+    for (int page = top / GRID_PAGE_ROWS; page <= bottom / GRID_PAGE_ROWS
+            && top <= bottom; page++) {
+        GridPage* shared = game->pages[page];
+        if (__atomic_load_n(&shared->refs, __ATOMIC_ACQUIRE) == 1) {
+            continue;
+        }
+
+        GridPage* copy = malloc(sizeof(GridPage));
+        copy->refs = 1;
+        copy->cells = malloc(GRID_PAGE_ROWS * rowSize);
+        memcpy(copy->cells, shared->cells, GRID_PAGE_ROWS * rowSize);
+        game->pages[page] = copy;
+
+        // Point this page's rows at the copy
+        int firstRow = page * GRID_PAGE_ROWS;
+        for (int row = firstRow; row < firstRow + GRID_PAGE_ROWS
+                && row < game->height; row++) {
+            game->grid[row] = copy->cells + (row - firstRow) * rowSize;
+        }
+
+        if (__atomic_sub_fetch(&shared->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+            free(shared->cells);
+            free(shared);
+        }
+    }
+}
+
+/*
+ * Makes sure a frame has space for extra more bytes.
+ *
+ * @param frame Frame to grow
+ * @param extra Number of bytes about to be added
+ * @return Pointer to the end of the frame's contents, to add bytes at
+ */
+char* reserve_frame(Frame* frame, long extra) {
+    if (frame->size + extra > frame->capacity) {
+        frame->capacity = (frame->size + extra) * 2;
+        frame->data = realloc(frame->data, frame->capacity);
+    }
+
+    return frame->data + frame->size;
 }
 
 /*
- * Places given tile on game grid and updates the last play information.
- * Assumes given tile and coordinates is a valid placement.
+ * Writes a frame's contents to stdout with a single write, and empties it.
+ * Anything already printed with stdio is flushed first to keep order.
  *
- * @param game Game struct
- * @param tile Tile to be placed on board
- * @param row Row where middle of tile will be placed (starting at 0)
- * @param column Column where middle of tile will be placed (starting at 0)
+ * @param frame Frame to write
  */
-void place_tile(Game* game, char tile[TILE_SIZE][TILE_SIZE], 
-        int row, int column) {
-            
-    for (int i = 0; i < TILE_SIZE; i++) {
-        for (int j = 0; j < TILE_SIZE; j++) {
-            // Translate cell in tile to location it will be placed on grid.
-            int xCord = (column - 2) + j;
-            int yCord = (row - 2) + i;
-            
-            char tileCell = tile[i][j];
-            
-            // Tile cell isn't being placed on board
-            if (xCord < 0 || yCord < 0 || xCord >= game->width 
-                    || yCord >= game->height) {
-                continue;
-            }
-            
-            // Only copy over non-empty tile cells
-            if (tileCell != EMPTY_TILE_CELL) {
-                game->grid[yCord][xCord] = PLAYER_SYMBOL(game->currentPlayer); 
-            }
-            
+void emit_frame(Frame* frame) {
+    fflush(stdout);
+
+    long written = 0;
+    while (written < frame->size) {
+        long result = write(STDOUT_FILENO, frame->data + written,
+                frame->size - written);
+        if (result <= 0) {
+            break;
         }
-    } 
-    
-    game->lastPlay[game->currentPlayer].row = row;
-    game->lastPlay[game->currentPlayer].column = column;
-    game->numMoves = game->numMoves + 1;
+        written += result;
+    }
+
+    frame->size = 0;
 }
 
 /*
@@ -600,12 +3282,16 @@ void place_tile(Game* game, char tile[TILE_SIZE][TILE_SIZE],
  * @param tile Tile to be printed
  */
 void print_tile(char tile[TILE_SIZE][TILE_SIZE]) {
+    char* pos = reserve_frame(&outputFrame, TILE_SIZE * (TILE_SIZE + 1));
+
     for (int row = 0; row < TILE_SIZE; row++) {
-        for (int column = 0; column < TILE_SIZE; column++) {
-            printf("%c", tile[row][column]);
-        }
-        printf("\n");    
+        memcpy(pos, tile[row], TILE_SIZE);
+        pos[TILE_SIZE] = '\n';
+        pos += TILE_SIZE + 1;
     }
+
+    outputFrame.size += TILE_SIZE * (TILE_SIZE + 1);
+    emit_frame(&outputFrame);
 }
 
 /*
@@ -618,6 +3304,8 @@ void print_tile(char tile[TILE_SIZE][TILE_SIZE]) {
  */
 void print_tilefile(int numTiles, 
         char tiles[numTiles][TILE_SIZE][TILE_SIZE]) {
+    // Each row holds 4 rotations and 4 separators (spaces, then a newline)
+    int lineLength = 4 * (TILE_SIZE + 1);
             
     for (int tile = 0; tile < numTiles; tile++) {
         // Store all four possible rotations for this particular tile
@@ -628,36 +3316,78 @@ void print_tilefile(int numTiles,
         rotate_tile(tiles[tile], rotations[2], 180);
         rotate_tile(tiles[tile], rotations[3], 270);
         
+        char* pos = reserve_frame(&outputFrame, TILE_SIZE * lineLength + 1);
         for (int row = 0; row < TILE_SIZE; row++) {
             // Need to print same row of each rotation on same line
             for (int curRotation = 0; curRotation < 4; curRotation++) {
-                for (int column = 0; column < TILE_SIZE; column++) {
-                    printf("%c", rotations[curRotation][row][column]);
-                }
+                memcpy(pos, rotations[curRotation][row], TILE_SIZE);
                 // Separate each rotation with space between (but not after)
-                if (curRotation != 3) {
-                    printf(" ");
-                }
+                pos[TILE_SIZE] = (curRotation != 3) ? ' ' : '\n';
+                pos += TILE_SIZE + 1;
             }
-            printf("\n");        
         }
+        outputFrame.size += TILE_SIZE * lineLength;
         
         // Print a blank line between tiles, but not afterwards.
         if (tile != (numTiles - 1)) {
-            printf("\n");
+            outputFrame.data[outputFrame.size++] = '\n';
         }
     }
+
+    emit_frame(&outputFrame);
 }
 
 /*
- * Prints current game grid to stdout.
+ * Prints current game grid to stdout, as one frame.
+ * In RENDER_DIFF mode, only the rows changed by the last move are printed
+ * (once a move has been made), each prefixed by its row number and a space.
+ * Nothing is printed in RENDER_QUIET or RENDER_NONE mode.
  *
  * @param game Game struct
  */
 void print_grid(Game* game) {
-    for (int row = 0; row < game->height; row++) {
-        printf("%s\n", game->grid[row]);
+    if (game->renderMode == RENDER_QUIET || game->renderMode == RENDER_NONE) {
+        return;
+    }
+
+    int top = 0, bottom = game->height - 1;
+    bool numbered = (game->renderMode == RENDER_DIFF && game->dirtyTop >= 0);
+    if (numbered) {
+        top = game->dirtyTop;
+        bottom = game->dirtyBottom;
+    }
+
+    // Row numbers take at most 4 characters (including space)
+    char* pos = reserve_frame(&outputFrame,
+            (long) (bottom - top + 1) * (game->width + 5));
+    for (int row = top; row <= bottom; row++) {
+        if (numbered) {
+            pos += sprintf(pos, "%d ", row);
+        }
+        memcpy(pos, game->grid[row], game->width);
+        pos[game->width] = '\n';
+        pos += game->width + 1;
+    }
+
+    outputFrame.size = pos - outputFrame.data;
+    emit_frame(&outputFrame);
+}
+
+/*
+ * Prints the move the current player just made, unless nothing is being
+ * printed (RENDER_NONE).
+ *
+ * @param game Game struct, with the move in the current player's last play
+ */
+void print_move(Game* game) {
+    if (game->renderMode == RENDER_NONE) {
+        return;
     }
+
+    PreviousMove* last = &game->lastPlay[game->currentPlayer];
+    printf("Player %c => %d %d rotated %d\n",
+            PLAYER_SYMBOL(game->currentPlayer), last->row, last->column,
+            last->rotation);
 }
 
 /*
@@ -700,12 +3430,12 @@ bool prompt_user(Game* game, char tile[TILE_SIZE][TILE_SIZE]) {
         rotate_tile(tile, tileRotation, rotation);
     
         if (is_tile_placeable(game, tileRotation, row, column)) {
-            place_tile(game, tileRotation, row, column);
+            place_tile(game, tileRotation, row, column, rotation);
             // User doesn't need to be prompted again.
             return true;
         }
     } else if (saveResult == 1) {
-        if (!write_savefile(game, savefileName)) {
+        if (!save_game(game, savefileName)) {
             fprintf(stderr, "Unable to save game\n");
         }
     }
@@ -713,6 +3443,183 @@ bool prompt_user(Game* game, char tile[TILE_SIZE][TILE_SIZE]) {
     return false;
 }
 
+/*
+ * Finds the next line of a script, reading another block of stdin if the
+ * buffer doesn't hold a whole line. The line's newline is replaced with a
+ * null terminator. Lines too long to fit in the buffer are cut short, and
+ * the rest of them skipped.
+ *
+ * @param script Script to read from
+ * @param length Set to length of line, not including its newline
+ * @return Start of line in script's buffer
+ * @exit ERROR_EOF if input ends before another whole line
+ */
+char* next_script_line(Script* script, long* length) {
+    while (true) {
+        char* line = script->buffer + script->start;
+        char* newline = memchr(line, '\n', script->end - script->start);
+        long partial = script->end - script->start;
+        if (newline != NULL || partial == SCRIPT_BUFFER_SIZE - 1) {
+            *length = (newline != NULL) ? newline - line : partial;
+            line[*length] = '\0';
+            script->start += (newline != NULL) ? *length + 1 : *length;
+
+            bool skipped = script->skipping;
+            script->skipping = (newline == NULL);
+            if (!skipped) {
+                script->lineNum++;
+                return line;
+            }
+            continue;
+        }
+
+        if (script->endOfInput) {
+            report_script_errors(script);
+            exit_game(ERROR_EOF);
+        }
+
+        // Move partial line to front of buffer
+        memmove(script->buffer, line, partial);
+        script->start = 0;
+        script->end = partial;
+
+        // Keep a byte spare, so a newline can always be put at the end
+        long bytesRead = read(STDIN_FILENO, script->buffer + script->end,
+                SCRIPT_BUFFER_SIZE - 1 - script->end);
+        if (bytesRead <= 0) {
+            script->endOfInput = true;
+        } else {
+            script->end += bytesRead;
+        }
+    }
+}
+
+/*
+ * Tokenises a script line in one pass. Accepts the same lines as
+ * prompt_user: three integers separated by single spaces with a rotation
+ * of 0, 90, 180 or 270, or "save" followed by a savefile path.
+ *
+ * @param line Null terminated line to parse (may be modified)
+ * @param length Length of line
+ * @param parsed Destination to store type of line and its values
+ */
+void parse_script_line(char* line, long length, ScriptLine* parsed) {
+    parsed->type = SCRIPT_INVALID;
+    if (length > MAX_VALID_LINE_LENGTH) {
+        return;
+    }
+
+    if (strncmp(line, "save", 4) == 0) {
+        // Path is the first word after "save", as sscanf("save%s") reads
+        char* path = line + 4;
+        while (isspace(*path)) {
+            path++;
+        }
+        char* pathEnd = path;
+        while (*pathEnd != '\0' && !isspace(*pathEnd)) {
+            pathEnd++;
+        }
+        *pathEnd = '\0';
+        if (pathEnd != path) {
+            parsed->type = SCRIPT_SAVE;
+            parsed->savefile = path;
+        }
+        return;
+    }
+
+    int values[3], numValues = 0;
+    char* pos = line;
+    while (numValues < 3) {
+        bool negative = (*pos == '-');
+        pos += negative;
+
+        // Up to nine digits, so the value fits in an int
+        int value = 0, digits = 0;
+        for (; isdigit(*pos) && digits < 10; pos++, digits++) {
+            value = value * 10 + (*pos - '0');
+        }
+        if (digits == 0 || digits == 10) {
+            return;
+        }
+        values[numValues++] = negative ? -value : value;
+
+        if (*pos != ' ' || numValues == 3) {
+            break;
+        }
+        pos++;
+    }
+
+    if (numValues != 3 || *pos != '\0' || (values[2] != 0
+            && values[2] != 90 && values[2] != 180 && values[2] != 270)) {
+        return;
+    }
+    parsed->type = SCRIPT_MOVE;
+    parsed->row = values[0];
+    parsed->column = values[1];
+    parsed->rotation = values[2];
+}
+
+/*
+ * Reads the next line of a human player's script, and makes its move or
+ * save. Lines that aren't legal moves or saves are remembered for
+ * report_script_errors rather than reported straight away.
+ *
+ * @param game Game struct, with script
+ * @param rotations Current tile at each rotation (0, 90, 180, 270)
+ * @return true if a move was made, false if another line must be read
+ * @exit ERROR_EOF if input ends before another whole line
+ */
+bool script_move(Game* game, char rotations[4][TILE_SIZE][TILE_SIZE]) {
+    Script* script = game->script;
+    long length;
+    char* line = next_script_line(script, &length);
+
+    ScriptLine parsed;
+    parse_script_line(line, length, &parsed);
+    if (parsed.type == SCRIPT_SAVE) {
+        if (!save_game(game, parsed.savefile)) {
+            fprintf(stderr, "Unable to save game\n");
+        }
+        return false;
+    }
+
+    if (parsed.type == SCRIPT_MOVE) {
+        char (*tileRotation)[TILE_SIZE] = rotations[parsed.rotation / 90];
+        if (is_tile_placeable(game, tileRotation, parsed.row,
+                parsed.column)) {
+            place_tile(game, tileRotation, parsed.row, parsed.column,
+                    parsed.rotation);
+            return true;
+        }
+    }
+
+    if (script->numInvalid < SCRIPT_REPORT_LINES) {
+        script->invalidLines[script->numInvalid] = script->lineNum;
+    }
+    script->numInvalid++;
+    return false;
+}
+
+/*
+ * Prints how many script lines weren't legal moves or saves to stderr,
+ * along with the line numbers of the first few, if there were any.
+ *
+ * @param script Script read from
+ */
+void report_script_errors(Script* script) {
+    if (script->numInvalid == 0) {
+        return;
+    }
+
+    fprintf(stderr, "%ld invalid script lines:", script->numInvalid);
+    for (long i = 0; i < script->numInvalid && i < SCRIPT_REPORT_LINES;
+            i++) {
+        fprintf(stderr, " %ld", script->invalidLines[i]);
+    }
+    fprintf(stderr, (script->numInvalid > SCRIPT_REPORT_LINES)
+            ? " ...\n" : "\n");
+}
+
 /*
  * Calculates, performs, and prints move for a type one automatic fitz player.
  * Assumes game is not already over and current tile is placeable somewhere.
@@ -722,6 +3629,8 @@ bool prompt_user(Game* game, char tile[TILE_SIZE][TILE_SIZE]) {
  */
 void auto_type_one_move(Game* game, char tile[TILE_SIZE][TILE_SIZE]) {
     int row, column, rowStart, columnStart;
+    unsigned int masks[TILE_SIZE];
+    get_tile_masks(tile, masks);
     
     // Use last move by either player if available, otherwise start at -2, -2
     if (game->numMoves == 0) {
@@ -736,17 +3645,40 @@ void auto_type_one_move(Game* game, char tile[TILE_SIZE][TILE_SIZE]) {
     row = rowStart;
     column = columnStart;
 
+    if (game->pool != NULL
+            && (long) game->height * game->width >= SEARCH_POOL_MIN_CELLS) {
+        int bounds[4] = {-2, game->height + 1, -2, game->width + 1};
+        PreviousMove move;
+        if (parallel_first_fit(game, tile, SEARCH_ROTATIONS_OUTER, bounds,
+                rowStart, columnStart, game->deadline, &move)
+                != SEARCH_FOUND) {
+            fallback_move(game, tile);
+            return;
+        }
+        char tileRotation[TILE_SIZE][TILE_SIZE];
+        rotate_tile(tile, tileRotation, move.rotation);
+        place_tile(game, tileRotation, move.row, move.column, move.rotation);
+        print_move(game);
+        return;
+    }
+
     for (int theta = 0; theta <= 270; theta += 90) {
         char tileRotation[TILE_SIZE][TILE_SIZE];
         rotate_tile(tile, tileRotation, theta);
         
         // Loop until row, column = rowStart, columnStart
         do { 
-            if (is_tile_placeable(game, tileRotation, row, column)) {
-                place_tile(game, tileRotation, row, column);
-                printf("Player %c => %d %d rotated %d\n", 
-                        PLAYER_SYMBOL(game->currentPlayer), 
-                        row, column, theta);
+            if (is_out_of_time(game)) {
+                fallback_move(game, tile);
+                return;
+            }
+            bool placeable = (game->views != NULL)
+                    ? is_view_placeable(game->views, masks, row, column,
+                    theta / 90)
+                    : is_tile_placeable(game, tileRotation, row, column);
+            if (placeable) {
+                place_tile(game, tileRotation, row, column, theta);
+                print_move(game);
                 return;
             }
             column += 1;
@@ -776,6 +3708,13 @@ void auto_type_one_move(Game* game, char tile[TILE_SIZE][TILE_SIZE]) {
 void auto_type_two_move(Game* game, char tile[TILE_SIZE][TILE_SIZE]) {
     int row, column, rowStart, columnStart;
     int currentPlayer = game->currentPlayer;
+    char rotations[4][TILE_SIZE][TILE_SIZE];
+    unsigned int masks[TILE_SIZE];
+    for (int i = 0; i < 4; i++) {
+        rotate_tile(tile, rotations[i], i * 90);
+    }
+    get_tile_masks(tile, masks);
+
     // If less than two moves have occured in game, then this player 
     // has no previous last move to refer to
     if (game->numMoves < 2) {
@@ -791,14 +3730,19 @@ void auto_type_two_move(Game* game, char tile[TILE_SIZE][TILE_SIZE]) {
     
     // Loop until row, column = rowStart, columnStart
     do {
+        if (is_out_of_time(game)) {
+            fallback_move(game, tile);
+            return;
+        }
         for (int theta = 0; theta <= 270; theta += 90) {
-            char tileRotation[TILE_SIZE][TILE_SIZE];
-            rotate_tile(tile, tileRotation, theta);
-            if (is_tile_placeable(game, tileRotation, row, column)) {
-                place_tile(game, tileRotation, row, column);
-                printf("Player %c => %d %d rotated %d\n", 
-                        PLAYER_SYMBOL(game->currentPlayer), 
-                        row, column, theta);
+            char (*tileRotation)[TILE_SIZE] = rotations[theta / 90];
+            bool placeable = (game->views != NULL)
+                    ? is_view_placeable(game->views, masks, row, column,
+                    theta / 90)
+                    : is_tile_placeable(game, tileRotation, row, column);
+            if (placeable) {
+                place_tile(game, tileRotation, row, column, theta);
+                print_move(game);
                 return;     
             }            
         }
@@ -810,6 +3754,9 @@ void auto_type_two_move(Game* game, char tile[TILE_SIZE][TILE_SIZE]) {
                 row += 1;
                 column = -2;
             }
+            if (row > game->height + 1) {
+                row = -2;
+            }
         } else if (currentPlayer == PLAYER_TWO) {
             // If second player, move right->left, bottom->top
             column -= 1;
@@ -817,10 +3764,158 @@ void auto_type_two_move(Game* game, char tile[TILE_SIZE][TILE_SIZE]) {
                 row -= 1;
                 column = game->width + 1;
             }
+            if (row < -2) {
+                row = game->height + 1;
+            }
         }
     } while (!(row == rowStart && column == columnStart));
 }
 
+/*
+ * Calculates, performs, and prints move for a mobility automatic player.
+ * Starting from the other player's last move (or -2, -2), the first
+ * MOBILITY_CANDIDATES legal placements in row, column, rotation order are
+ * compared. The one leaving the other player the fewest placements for the
+ * next tile, less the placements left for this player's following tile,
+ * is chosen (the first, if tied). A placement leaving the other player
+ * none wins immediately, so is always chosen.
+ * Assumes game is not already over and current tile is placeable somewhere.
+ *
+ * @param game Game struct, with mobility counts
+ * @param tile Current tile to place on grid
+ */
+void auto_mobility_move(Game* game, char tile[TILE_SIZE][TILE_SIZE]) {
+    int numTiles = game->mobility->numTiles;
+    int nextTile = (game->currentTile + 1) % numTiles;
+    int followingTile = (game->currentTile + 2) % numTiles;
+    long nextMobility = get_mobility(game, nextTile);
+    long followingMobility = get_mobility(game, followingTile);
+
+    int rows = game->height + 4, columns = game->width + 4;
+    long positions = (long) rows * columns, start = 0;
+    if (game->numMoves > 0) {
+        start = (long) (game->lastPlay[!game->currentPlayer].row + 2)
+                * columns + game->lastPlay[!game->currentPlayer].column + 2;
+    }
+
+    int candidates = 0, bestRow = 0, bestColumn = 0, bestRotation = 0;
+    long bestScore = 0;
+    for (long i = 0; i < positions && candidates < MOBILITY_CANDIDATES; i++) {
+        // Out of time: use the best candidate so far, if there is one
+        if (is_out_of_time(game)) {
+            if (candidates == 0) {
+                fallback_move(game, tile);
+                return;
+            }
+            break;
+        }
+        int row = (start + i) % positions / columns - 2;
+        int column = (start + i) % positions % columns - 2;
+
+        for (int rotation = 0; rotation < 4; rotation++) {
+            char (*tileRotation)[TILE_SIZE] = game->mobility->rotations
+                    [game->currentTile][rotation];
+            if (!is_tile_placeable(game, tileRotation, row, column)) {
+                continue;
+            }
+
+            long opponent = nextMobility - count_blocked_placements(game,
+                    nextTile, tileRotation, row, column, NULL);
+            long own = followingMobility - count_blocked_placements(game,
+                    followingTile, tileRotation, row, column, NULL);
+            long score = (opponent == 0) ? LONG_MAX : own - opponent;
+
+            if (candidates++ == 0 || score > bestScore) {
+                bestScore = score;
+                bestRow = row;
+                bestColumn = column;
+                bestRotation = rotation;
+            }
+        }
+    }
+
+    place_tile(game, game->mobility->rotations[game->currentTile]
+            [bestRotation], bestRow, bestColumn, bestRotation * 90);
+    print_move(game);
+}
+
+/*
+ * Calculates, performs, and prints move for a random automatic player.
+ * With chance epsilon, a legal placement is chosen uniformly at random.
+ * Otherwise the first legal placement in row, column, rotation order is
+ * chosen. Assumes current tile is placeable somewhere.
+ *
+ * @param game Game struct
+ * @param tile Current tile to place on grid
+ * @param epsilon Chance of choosing a random placement (1 always does)
+ */
+void random_move(Game* game, char tile[TILE_SIZE][TILE_SIZE],
+        double epsilon) {
+    TileShape shapes[4];
+    for (int rotation = 0; rotation < 4; rotation++) {
+        char tileRotation[TILE_SIZE][TILE_SIZE];
+        rotate_tile(tile, tileRotation, rotation * 90);
+        get_tile_shape(tileRotation, &shapes[rotation]);
+    }
+
+    PreviousMove moves[4 * (game->width + 4)];
+    int numMoves = 0, choice = 0;
+    int row = -2;
+    // Top 53 bits of a random number give an evenly spread double in [0, 1)
+    if ((next_random(game) >> 11) * (1.0 / (1ULL << 53)) < epsilon) {
+        // Count placements row by row, then regenerate the chosen one's row
+        long rowCounts[game->height + 4], total = 0;
+        for (row = -2; row <= game->height + 1; row++) {
+            // Out of time: choose from the rows counted so far, if any
+            if (is_out_of_time(game)) {
+                if (total == 0) {
+                    fallback_move(game, tile);
+                    return;
+                }
+                break;
+            }
+            rowCounts[row + 2] = generate_row_moves(game, shapes, row, moves);
+            total += rowCounts[row + 2];
+        }
+
+        long index = next_random(game) % total;
+        for (row = -2; index >= rowCounts[row + 2]; row++) {
+            index -= rowCounts[row + 2];
+        }
+        numMoves = generate_row_moves(game, shapes, row, moves);
+        choice = index;
+    } else {
+        for (; row <= game->height + 1 && numMoves == 0; row++) {
+            if (is_out_of_time(game)) {
+                fallback_move(game, tile);
+                return;
+            }
+            numMoves = generate_row_moves(game, shapes, row, moves);
+        }
+    }
+
+    PreviousMove* move = &moves[choice];
+    char tileRotation[TILE_SIZE][TILE_SIZE];
+    rotate_tile(tile, tileRotation, move->rotation);
+    place_tile(game, tileRotation, move->row, move->column, move->rotation);
+    print_move(game);
+}
+
+/*
+ * Performs and prints the fallback move is_game_over found, for an
+ * automatic player that ran out of time before choosing its own move.
+ *
+ * @param game Game struct
+ * @param tile Current tile to place on grid
+ */
+void fallback_move(Game* game, char tile[TILE_SIZE][TILE_SIZE]) {
+    char tileRotation[TILE_SIZE][TILE_SIZE];
+    rotate_tile(tile, tileRotation, game->fallback.rotation);
+    place_tile(game, tileRotation, game->fallback.row, game->fallback.column,
+            game->fallback.rotation);
+    print_move(game);
+}
+
 /*
  * Exits program with specified error code.
  * Also prints an informative message to stderr.
@@ -852,9 +3947,18 @@ void exit_game(int exitCode) {
         case ERROR_SAVEFILE_INVALID:
             fprintf(stderr, "Invalid save file contents\n");
             break;
+        case ERROR_MOVELOG_UNREADABLE:
+            fprintf(stderr, "Can't access move log\n");
+            break;
+        case ERROR_MOVELOG_INVALID:
+            fprintf(stderr, "Invalid move log contents\n");
+            break;
         case ERROR_EOF:
             fprintf(stderr, "End of input\n");
             break;
+        case ERROR_BOOK_INVALID:
+            fprintf(stderr, "Invalid opening book\n");
+            break;
         default:
             break;
     }
@@ -905,60 +4009,13 @@ bool read_line(char* buffer, int bufferSize, FILE* fileStream, int lineNum) {
 }
 
 
-/*
- * Checks a given input is a space delimited line of a specified amount of
- * integers with no trailing or leading whitespace. Integers can only have
- * one space between them.
- *
- * For example ("1 1 0", 3), ("-1 0 2 4", 4) is valid,
- * but ("1 1 0", 2), (" 1 1 0 ", 3), ("2.0 0 0", 3), ("2    2 0", 3) are not.
- *
- * @param input Input to check
- * @param numInputs Number of separated inputs if line is to be valid
- * @return true if valid, false otherwise
- */
-bool is_valid_input_line(char* input, int numInputs) {
-    int inputLength = strlen(input);
-    
-    // If leading or trailing whitespace, invalid
-    if (isspace(input[0]) || isspace(input[inputLength - 1])) {
-        return false;
-    }
-    
-    int inputCount = 1;
-        
-    for (int i = 0; i < inputLength; i++) {
-        if (isspace(input[i])) {
-            // two spaces in a row means invalid.
-            if (isspace(input[i + 1])) {
-                return false;
-            }
-            inputCount++;
-        } else if (input[i] == '-') {
-            // If a negative sign occurs and isn't immediately preceded
-            // by a space, or at the start of string, invalid
-            if (i > 0 && !isspace(input[i - 1])) {
-                return false;
-            }
-            // If a negative sign occurs and isn't followed by digit, invalid
-            if (!isdigit(input[i + 1])) {
-                return false;
-            }
-        } else if (!isdigit(input[i])) {
-            // Not a space, minus sign, or digit, therefore invalid
-            return false;
-        }
-    }
-    
-    return inputCount == numInputs;
-}
-
 /*
  * Converts given input to a player type.
  *
  * @param input String to be converted to player type
- * @return PLAYER_TYPE_HUMAN, PLAYER_TYPE_AUTO_ONE, or PLAYER_TYPE_AUTO_TWO
- *         if successful
+ * @return PLAYER_TYPE_HUMAN, PLAYER_TYPE_AUTO_ONE, PLAYER_TYPE_AUTO_TWO,
+ *         PLAYER_TYPE_AUTO_MOBILITY, PLAYER_TYPE_RANDOM or
+ *         PLAYER_TYPE_EPSILON if successful
  * @return -1 if invalid input
  */
 int get_player_type(char* input) {
@@ -968,6 +4025,12 @@ int get_player_type(char* input) {
         return PLAYER_TYPE_AUTO_ONE;
     } else if (strcmp(input, "2") == 0) {
         return PLAYER_TYPE_AUTO_TWO;
+    } else if (strcmp(input, "3") == 0) {
+        return PLAYER_TYPE_AUTO_MOBILITY;
+    } else if (strcmp(input, "r") == 0) {
+        return PLAYER_TYPE_RANDOM;
+    } else if (strcmp(input, "e") == 0) {
+        return PLAYER_TYPE_EPSILON;
     } else {
         return -1;
     }
@@ -993,3 +4056,56 @@ int str_to_int(char* str, bool* error) {
 
     return (int) value;
 }
+
+/*
+ * Gets the starting state of a game's random number generator. The seed
+ * and game number are both mixed in, so games of a batch draw unrelated
+ * streams rather than one stream shifted along.
+ *
+ * @param seed Seed given with --seed
+ * @param gameNumber Number of the game in its batch, 0 for a single game
+ * @return Starting random state
+ */
+unsigned long long start_random(int seed, int gameNumber) {
+    return mix_bits((unsigned long long) seed ^ mix_bits(gameNumber));
+}
+
+/*
+ * Gets the next number from the game's random number generator
+ * (splitmix64, so each game's stream depends only on its starting state).
+ *
+ * @param game Game struct
+ * @return Random 64 bit number
+ */
+unsigned long long next_random(Game* game) {
+    game->randomState += RANDOM_STATE_STEP;
+    return mix_bits(game->randomState);
+}
+
+/*
+ * Gets the time from a monotonic clock, which never jumps when the system
+ * time is changed.
+ *
+ * @return Time in nanoseconds since an arbitrary starting point
+ */
+long long get_clock_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+/*
+ * Counts a position searched by an auto player, and every
+ * DEADLINE_CHECK_NODES positions checks whether its move is overdue.
+ *
+ * @param game Game struct
+ * @return true if the move's deadline has passed, false otherwise
+ */
+bool is_out_of_time(Game* game) {
+    if (game->deadline == 0
+            || ++game->searchNodes % DEADLINE_CHECK_NODES != 0) {
+        return false;
+    }
+
+    return get_clock_ns() >= game->deadline;
+}
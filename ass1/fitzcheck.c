@@ -0,0 +1,350 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "lib/savefile.h"
+
+/* Exit status codes */
+#define EXIT_ALL_VALID 0
+#define ERROR_INCORRECT_ARGS 1
+#define ERROR_FILES_INVALID 2
+
+/* Compact savefile format. See write_compact_savefile for layout */
+#define COMPACT_MAGIC "FZSB"
+#define COMPACT_VERSION 1
+#define COMPACT_HEADER_SIZE 16
+#define COMPACT_EXTENSION ".fzb"
+
+/*
+ * Command line options
+ *  - numThreads: Number of threads checking savefiles
+ *  - numTiles: Number of tiles savefiles are played with, or 0 if unknown
+ *  - convertDir: Directory to write compact savefiles to, or NULL
+ */
+typedef struct {
+    int numThreads;
+    int numTiles;
+    char* convertDir;
+} Options;
+
+/*
+ * Result of checking one savefile
+ *  - filename: Path of savefile
+ *  - error: Description of the first problem found, or NULL if valid
+ *  - line: Line of the savefile the problem is on (starting at 1), or 0
+ *  - converted: Whether a compact copy of the savefile was written
+ *  - nameTaken: Whether an earlier savefile's compact copy has the same
+ *    name, so this one can't be converted
+ */
+typedef struct {
+    char* filename;
+    const char* error;
+    int line;
+    bool converted;
+    bool nameTaken;
+} FileReport;
+
+/*
+ * Work shared by every checking thread
+ *  - options: Command line options
+ *  - numFiles: Number of savefiles to check
+ *  - reports: Report for each savefile, filename already set
+ *  - nextFile: Index of the next savefile no thread has started on
+ */
+typedef struct {
+    Options* options;
+    int numFiles;
+    FileReport* reports;
+    int nextFile;
+} CheckQueue;
+
+/* Checking functions */
+int parse_options(int argc, char** argv, Options* options);
+void* run_check_thread(void* arg);
+void check_savefile(Options* options, FileReport* report);
+
+/* Conversion functions */
+char* get_base_name(char* filename);
+int compare_base_names(const void* first, const void* second);
+void mark_taken_names(int numFiles, FileReport* reports);
+bool write_compact_savefile(Options* options, char* filename,
+        Savefile* save);
+
+int main(int argc, char** argv) {
+    Options options = {.numThreads = 1};
+    int first = parse_options(argc, argv, &options);
+    if (first == argc) {
+        fprintf(stderr, "Usage: fitzcheck [--threads n] [--tiles n] "
+                "[--convert dir] savefile ...\n");
+        return ERROR_INCORRECT_ARGS;
+    }
+
+    CheckQueue queue = {&options, argc - first, NULL, 0};
+    queue.reports = calloc(queue.numFiles, sizeof(FileReport));
+    for (int i = 0; i < queue.numFiles; i++) {
+        queue.reports[i].filename = argv[first + i];
+    }
+    if (options.convertDir != NULL) {
+        mark_taken_names(queue.numFiles, queue.reports);
+    }
+
+    pthread_t threads[options.numThreads];
+    for (int i = 0; i < options.numThreads; i++) {
+        pthread_create(&threads[i], NULL, run_check_thread, &queue);
+    }
+    for (int i = 0; i < options.numThreads; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    // Reports are printed in command line order, whichever thread ran them
+    int numInvalid = 0, numConverted = 0;
+    for (int i = 0; i < queue.numFiles; i++) {
+        FileReport* report = &queue.reports[i];
+        if (report->error == NULL) {
+            printf("%s: ok\n", report->filename);
+        } else if (report->line > 0) {
+            printf("%s: %s (line %d)\n", report->filename, report->error,
+                    report->line);
+        } else {
+            printf("%s: %s\n", report->filename, report->error);
+        }
+        numInvalid += (report->error != NULL);
+        numConverted += report->converted;
+    }
+
+    printf("%d checked, %d valid, %d invalid", queue.numFiles,
+            queue.numFiles - numInvalid, numInvalid);
+    if (options.convertDir != NULL) {
+        printf(", %d converted", numConverted);
+    }
+    printf("\n");
+
+    free(queue.reports);
+    return (numInvalid > 0) ? ERROR_FILES_INVALID : EXIT_ALL_VALID;
+}
+
+/*
+ * Parses options starting with "--" at the start of the command line.
+ *
+ * Recognised options:
+ *  --threads N     Check savefiles with N threads
+ *  --tiles N       Savefiles are played with N tiles, so must have next
+ *                  tile less than N
+ *  --convert DIR   Write a compact copy of each valid savefile into DIR.
+ *                  Savefiles whose base name an earlier one already used
+ *                  are reported rather than overwriting its copy.
+ *
+ * @param argc Argument count passed from main()
+ * @param argv Arguments passed from main()
+ * @param options Destination to store options given
+ * @return Index of first savefile in argv, or argc if arguments are invalid
+ */
+int parse_options(int argc, char** argv, Options* options) {
+    int i = 1;
+
+    for (; i < argc && strncmp(argv[i], "--", 2) == 0; i++) {
+        if (i + 1 == argc) {
+            return argc;
+        }
+
+        char* end;
+        if (strcmp(argv[i], "--threads") == 0) {
+            options->numThreads = strtol(argv[++i], &end, 10);
+            if (*end != '\0' || options->numThreads < 1) {
+                return argc;
+            }
+        } else if (strcmp(argv[i], "--tiles") == 0) {
+            options->numTiles = strtol(argv[++i], &end, 10);
+            if (*end != '\0' || options->numTiles < 1) {
+                return argc;
+            }
+        } else if (strcmp(argv[i], "--convert") == 0) {
+            options->convertDir = argv[++i];
+        } else {
+            return argc;
+        }
+    }
+
+    return i;
+}
+
+/*
+ * Checks savefiles from the shared queue until none are left.
+ *
+ * @param arg CheckQueue shared by every thread
+ * @return NULL
+ */
+void* run_check_thread(void* arg) {
+    CheckQueue* queue = (CheckQueue*) arg;
+
+    while (true) {
+        int file = __atomic_fetch_add(&queue->nextFile, 1, __ATOMIC_RELAXED);
+        if (file >= queue->numFiles) {
+            return NULL;
+        }
+        check_savefile(queue->options, &queue->reports[file]);
+    }
+}
+
+/*
+ * Checks one savefile, memory mapping it rather than reading it, and
+ * writes its compact copy if asked to and it's valid.
+ *
+ * @param options Command line options
+ * @param report Report with savefile's filename, to fill in
+ */
+void check_savefile(Options* options, FileReport* report) {
+    int fd = open(report->filename, O_RDONLY);
+    struct stat info;
+
+    if (fd == -1 || fstat(fd, &info) == -1) {
+        report->error = "can't access save file";
+        if (fd != -1) {
+            close(fd);
+        }
+        return;
+    }
+
+    long size = info.st_size;
+    char* data = (size > 0)
+            ? mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0) : NULL;
+    close(fd);
+    if (data == MAP_FAILED) {
+        report->error = "can't access save file";
+        return;
+    }
+
+    Savefile save;
+    report->error = check_savefile_contents(data, size, options->numTiles,
+            &save, &report->line);
+    if (report->error == NULL && report->nameTaken) {
+        report->error = "compact save file name already used";
+    } else if (report->error == NULL && options->convertDir != NULL) {
+        report->converted = write_compact_savefile(options, report->filename,
+                &save);
+        if (!report->converted) {
+            report->error = "can't write compact save file";
+        }
+    }
+
+    if (data != NULL) {
+        munmap(data, size);
+    }
+}
+
+/*
+ * Gets the last component of a path, which compact copies are named after.
+ *
+ * @param filename Path of savefile
+ * @return Part of filename after its last '/'
+ */
+char* get_base_name(char* filename) {
+    char* base = strrchr(filename, '/');
+    return (base == NULL) ? filename : base + 1;
+}
+
+/*
+ * Orders savefile reports by base name, then by their order on the
+ * command line.
+ *
+ * @param first Pointer to first FileReport pointer
+ * @param second Pointer to second FileReport pointer
+ * @return Negative, zero or positive as first sorts before, with or after
+ *         second
+ */
+int compare_base_names(const void* first, const void* second) {
+    FileReport* a = *(FileReport**) first;
+    FileReport* b = *(FileReport**) second;
+    int order = strcmp(get_base_name(a->filename),
+            get_base_name(b->filename));
+    return (order != 0) ? order : (a > b) - (a < b);
+}
+
+/*
+ * Marks every savefile whose compact copy would have the same name as an
+ * earlier savefile's (e.g. a/save and b/save), so it isn't overwritten.
+ * Reports are sorted by base name so clashes are found in O(n log n).
+ *
+ * @param numFiles Number of savefiles
+ * @param reports Report for each savefile, in command line order
+ */
+void mark_taken_names(int numFiles, FileReport* reports) {
+    FileReport** sorted = malloc(sizeof(FileReport*) * numFiles);
+    for (int i = 0; i < numFiles; i++) {
+        sorted[i] = &reports[i];
+    }
+    qsort(sorted, numFiles, sizeof(FileReport*), compare_base_names);
+
+    for (int i = 1; i < numFiles; i++) {
+        sorted[i]->nameTaken = strcmp(get_base_name(sorted[i]->filename),
+                get_base_name(sorted[i - 1]->filename)) == 0;
+    }
+    free(sorted);
+}
+
+/*
+ * Writes a compact copy of a valid savefile into the conversion directory,
+ * named after the savefile with COMPACT_EXTENSION added. Layout, with
+ * integers little endian:
+ *  - bytes 0-3: COMPACT_MAGIC
+ *  - bytes 4-5: COMPACT_VERSION
+ *  - bytes 6-7: next player
+ *  - bytes 8-11: next tile
+ *  - bytes 12-13, 14-15: grid height, grid width
+ * Then the grid's cells in row order at 2 bits each (0 for '.', 1 for '*',
+ * 2 for '#'), four to a byte starting from the lowest bits.
+ *
+ * @param options Command line options
+ * @param filename Path of savefile being converted
+ * @param save Details of the savefile
+ * @return true if written, false otherwise
+ */
+bool write_compact_savefile(Options* options, char* filename,
+        Savefile* save) {
+    char* base = get_base_name(filename);
+
+    char path[strlen(options->convertDir) + strlen(base)
+            + strlen(COMPACT_EXTENSION) + 2];
+    sprintf(path, "%s/%s%s", options->convertDir, base, COMPACT_EXTENSION);
+
+    long cells = (long) save->height * save->width;
+    long size = COMPACT_HEADER_SIZE + (cells + 3) / 4;
+    unsigned char* data = calloc(size, 1);
+
+    memcpy(data, COMPACT_MAGIC, 4);
+    data[4] = COMPACT_VERSION;
+    data[6] = save->currentPlayer;
+    for (int i = 0; i < 4; i++) {
+        data[8 + i] = (unsigned int) save->nextTile >> (8 * i);
+    }
+    data[12] = save->height & 0xFF;
+    data[13] = save->height >> 8;
+    data[14] = save->width & 0xFF;
+    data[15] = save->width >> 8;
+
+    unsigned char* packed = data + COMPACT_HEADER_SIZE;
+    long cell = 0;
+    for (int row = 0; row < save->height; row++) {
+        const char* cells = save->grid + (long) row * (save->width + 1);
+        for (int column = 0; column < save->width; column++, cell++) {
+            int value = (cells[column] == '*') ? 1
+                    : (cells[column] == '#') ? 2 : 0;
+            packed[cell / 4] |= value << (2 * (cell % 4));
+        }
+    }
+
+    FILE* file = fopen(path, "wb");
+    bool written = file != NULL && fwrite(data, 1, size, file) == size;
+    if (file != NULL && fclose(file) != 0) {
+        written = false;
+    }
+
+    free(data);
+    return written;
+}
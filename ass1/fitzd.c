@@ -0,0 +1,637 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <ctype.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include "lib/tiles.h"
+
+/* Exit status codes */
+#define ERROR_INCORRECT_ARGS 1
+#define ERROR_TILEFILE_UNREADABLE 2
+#define ERROR_TILEFILE_INVALID 3
+#define ERROR_INVALID_DIMENSIONS 5
+#define ERROR_LISTEN 6
+
+#define MAX_BOARD_SIZE 999
+#define LISTEN_BACKLOG 1024
+#define MAX_EVENTS 256
+#define MAX_LINE_LENGTH 70
+
+/* Macro to give player symbol from player int */
+#define PLAYER_SYMBOL(x) ((x) == 0 ? '*' : '#')
+
+/*
+ * Memory for one match, released all at once when it ends
+ *  - base: Start of memory
+ *  - used: Number of bytes handed out so far
+ *  - size: Number of bytes in memory
+ */
+typedef struct {
+    char* base;
+    long used;
+    long size;
+} Arena;
+
+struct Match;
+
+/*
+ * A client connected to the server
+ *  - fd: Socket connected to the client
+ *  - match: Match the client is playing in, or NULL if not (yet) in one
+ *  - player: Player the client is in its match (0 or 1)
+ *  - input: Bytes received that aren't a whole line yet
+ *  - inputUsed: Number of bytes in input
+ *  - output: Bytes waiting to be sent, once the socket has room
+ *  - outputUsed: Number of bytes in output
+ *  - outputCapacity: Number of bytes allocated for output
+ *  - watchingOutput: Whether epoll is watching for room to send output
+ *  - closeWhenSent: Whether to disconnect once output has been sent
+ *  - closed: Whether the connection is closed, but not yet freed
+ *  - nextClosed: Next closed connection waiting to be freed
+ */
+typedef struct Connection {
+    int fd;
+    struct Match* match;
+    int player;
+    char input[MAX_LINE_LENGTH + 2];
+    int inputUsed;
+    char* output;
+    int outputUsed;
+    int outputCapacity;
+    bool watchingOutput;
+    bool closeWhenSent;
+    bool closed;
+    struct Connection* nextClosed;
+} Connection;
+
+/*
+ * A game between two connected clients
+ *  - arena: Memory the match and its grid are in
+ *  - cells: Grid, height * width cells in row order
+ *  - players: Connection of each player, or NULL once disconnected
+ *  - currentPlayer: Player whose turn it is (0 or 1)
+ *  - currentTile: Tile the current player must place
+ */
+typedef struct Match {
+    Arena arena;
+    char* cells;
+    Connection* players[2];
+    int currentPlayer;
+    int currentTile;
+} Match;
+
+/*
+ * State of the whole server
+ *  - height, width: Size of every match's grid
+ *  - numTiles: Number of tiles in the tile cycle
+ *  - rotations: Every tile at every rotation, shared by all matches
+ *  - epollFd: Epoll instance watching every socket
+ *  - listenFd: Socket clients connect to
+ *  - spareFd: Descriptor held back so a client can still be accepted (and
+ *    turned away) once the server runs out of descriptors, or -1
+ *  - waiting: Client waiting for an opponent, or NULL
+ *  - closedList: Connections closed during this batch of events
+ *  - matchesStarted, matchesFinished: Number of matches so far
+ */
+typedef struct {
+    int height;
+    int width;
+    int numTiles;
+    char (*rotations)[4][TILE_SIZE][TILE_SIZE];
+    int epollFd;
+    int listenFd;
+    int spareFd;
+    Connection* waiting;
+    Connection* closedList;
+    long matchesStarted;
+    long matchesFinished;
+} Server;
+
+// Set by a SIGINT or SIGTERM handler to stop the event loop
+volatile sig_atomic_t stopping = 0;
+
+/* Setup functions */
+int open_listen_socket(char* address);
+void handle_stop_signal(int signal);
+void run_event_loop(Server* server);
+
+/* Connection functions */
+void accept_connections(Server* server);
+void read_connection(Server* server, Connection* conn);
+void send_line(Server* server, Connection* conn, const char* format, ...);
+void flush_output(Server* server, Connection* conn);
+void close_connection(Server* server, Connection* conn);
+
+/* Match functions */
+void* arena_alloc(Arena* arena, long size);
+void start_match(Server* server, Connection* first, Connection* second);
+void begin_turn(Server* server, Match* match);
+void handle_line(Server* server, Connection* conn, char* line);
+void end_match(Server* server, Match* match, int winner);
+
+int main(int argc, char** argv) {
+    if (argc != 5) {
+        fprintf(stderr, "Usage: fitzd tilefile height width "
+                "port|socketpath\n");
+        return ERROR_INCORRECT_ARGS;
+    }
+
+    Server server;
+    memset(&server, 0, sizeof(Server));
+    server.numTiles = count_tiles(argv[1]);
+    if (server.numTiles == TILEFILE_UNREADABLE) {
+        fprintf(stderr, "Can't access tile file\n");
+        return ERROR_TILEFILE_UNREADABLE;
+    } else if (server.numTiles == TILEFILE_INVALID) {
+        fprintf(stderr, "Invalid tile file contents\n");
+        return ERROR_TILEFILE_INVALID;
+    }
+
+    char* end1;
+    char* end2;
+    server.height = strtol(argv[2], &end1, 10);
+    server.width = strtol(argv[3], &end2, 10);
+    if (*end1 != '\0' || *end2 != '\0' || server.height < 1
+            || server.height > MAX_BOARD_SIZE || server.width < 1
+            || server.width > MAX_BOARD_SIZE) {
+        fprintf(stderr, "Invalid dimensions\n");
+        return ERROR_INVALID_DIMENSIONS;
+    }
+
+    // Tiles are loaded and rotated once, then only read by every match
+    char tiles[server.numTiles][TILE_SIZE][TILE_SIZE];
+    if (!load_tiles(argv[1], server.numTiles, tiles)) {
+        fprintf(stderr, "Can't access tile file\n");
+        return ERROR_TILEFILE_UNREADABLE;
+    }
+    server.rotations = malloc(sizeof(*server.rotations) * server.numTiles);
+    for (int tile = 0; tile < server.numTiles; tile++) {
+        for (int i = 0; i < 4; i++) {
+            rotate_tile(tiles[tile], server.rotations[tile][i], i * 90);
+        }
+    }
+
+    server.listenFd = open_listen_socket(argv[4]);
+    if (server.listenFd == -1) {
+        fprintf(stderr, "Unable to listen on %s\n", argv[4]);
+        return ERROR_LISTEN;
+    }
+    server.spareFd = open("/dev/null", O_RDONLY);
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = handle_stop_signal;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    run_event_loop(&server);
+    printf("Played %ld matches\n", server.matchesFinished);
+    return 0;
+}
+
+/*
+ * Opens a non-blocking socket listening for clients. An address made only
+ * of digits is a TCP port (on every interface), anything else is the path
+ * of a UNIX socket, replacing any file already there.
+ *
+ * @param address Port or socket path to listen on
+ * @return Listening socket, or -1 if it couldn't be opened
+ */
+int open_listen_socket(char* address) {
+    bool isPort = (*address != '\0');
+    for (char* pos = address; *pos != '\0'; pos++) {
+        isPort = isPort && isdigit(*pos);
+    }
+
+    int fd;
+    if (isPort) {
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        addr.sin_port = htons(atoi(address));
+
+        fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+        if (fd == -1) {
+            return -1;
+        }
+        int reuse = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        if (bind(fd, (struct sockaddr*) &addr, sizeof(addr)) == -1) {
+            close(fd);
+            return -1;
+        }
+    } else {
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if (strlen(address) >= sizeof(addr.sun_path)) {
+            return -1;
+        }
+        strcpy(addr.sun_path, address);
+        unlink(address);
+
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
+        if (fd == -1) {
+            return -1;
+        }
+        if (bind(fd, (struct sockaddr*) &addr, sizeof(addr)) == -1) {
+            close(fd);
+            return -1;
+        }
+    }
+
+    if (listen(fd, LISTEN_BACKLOG) == -1) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/*
+ * Asks the event loop to stop after its current batch of events.
+ *
+ * @param signal Signal received
+ */
+void handle_stop_signal(int signal) {
+    stopping = 1;
+}
+
+/*
+ * Waits for and handles socket events until a stop signal arrives.
+ * Every socket is non-blocking and watched by a single epoll instance.
+ * Connections closed while handling a batch of events are only freed once
+ * the batch is done, as later events in it may refer to them.
+ *
+ * @param server Server state, with listening socket open
+ */
+void run_event_loop(Server* server) {
+    server->epollFd = epoll_create1(0);
+    struct epoll_event event = {.events = EPOLLIN, .data.ptr = NULL};
+    epoll_ctl(server->epollFd, EPOLL_CTL_ADD, server->listenFd, &event);
+
+    struct epoll_event events[MAX_EVENTS];
+    while (!stopping) {
+        int numEvents = epoll_wait(server->epollFd, events, MAX_EVENTS, -1);
+
+        for (int i = 0; i < numEvents; i++) {
+            Connection* conn = events[i].data.ptr;
+            if (conn == NULL) {
+                accept_connections(server);
+                continue;
+            }
+            if (!conn->closed && (events[i].events & EPOLLOUT)) {
+                flush_output(server, conn);
+            }
+            if (!conn->closed
+                    && (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))) {
+                read_connection(server, conn);
+            }
+        }
+
+        while (server->closedList != NULL) {
+            Connection* conn = server->closedList;
+            server->closedList = conn->nextClosed;
+            free(conn->output);
+            free(conn);
+        }
+    }
+}
+
+/*
+ * Accepts every pending client. Each client is paired with the client
+ * waiting for an opponent, or waits for one itself.
+ *
+ * If the server is out of descriptors, pending clients are accepted with
+ * the spare descriptor and closed straight away. Left pending, they would
+ * keep the listening socket readable and the event loop spinning.
+ *
+ * @param server Server state
+ */
+void accept_connections(Server* server) {
+    while (true) {
+        int fd = accept(server->listenFd, NULL, NULL);
+        if (fd == -1 && (errno == EMFILE || errno == ENFILE)
+                && server->spareFd != -1) {
+            close(server->spareFd);
+            int dropped = accept(server->listenFd, NULL, NULL);
+            if (dropped != -1) {
+                close(dropped);
+            }
+            server->spareFd = open("/dev/null", O_RDONLY);
+            if (dropped == -1) {
+                return;
+            }
+            continue;
+        }
+        if (fd == -1) {
+            return;
+        }
+        fcntl(fd, F_SETFL, O_NONBLOCK);
+        // Moves are single short lines, so don't hold them back (TCP only)
+        int noDelay = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+
+        Connection* conn = calloc(1, sizeof(Connection));
+        conn->fd = fd;
+        struct epoll_event event = {.events = EPOLLIN, .data.ptr = conn};
+        epoll_ctl(server->epollFd, EPOLL_CTL_ADD, fd, &event);
+
+        if (server->waiting == NULL) {
+            server->waiting = conn;
+        } else {
+            start_match(server, server->waiting, conn);
+            server->waiting = NULL;
+        }
+    }
+}
+
+/*
+ * Reads what a client has sent and handles each complete line.
+ * Lines too long to be valid are replaced by an empty (invalid) line.
+ * The client is disconnected once it closes its end.
+ *
+ * @param server Server state
+ * @param conn Connection with data waiting
+ */
+void read_connection(Server* server, Connection* conn) {
+    char buffer[4096];
+    long bytesRead = recv(conn->fd, buffer, sizeof(buffer), 0);
+    if (bytesRead == -1 && (errno == EAGAIN || errno == EINTR)) {
+        return;
+    } else if (bytesRead <= 0) {
+        close_connection(server, conn);
+        return;
+    }
+
+    for (long i = 0; i < bytesRead && !conn->closed; i++) {
+        if (buffer[i] == '\n') {
+            conn->input[conn->inputUsed] = '\0';
+            conn->inputUsed = 0;
+            handle_line(server, conn, conn->input);
+        } else if (conn->inputUsed <= MAX_LINE_LENGTH) {
+            conn->input[conn->inputUsed++] = buffer[i];
+        } else {
+            // Overlong line: keep it invalid without storing any more of it
+            conn->input[0] = '\0';
+            conn->inputUsed = MAX_LINE_LENGTH + 1;
+        }
+    }
+}
+
+/*
+ * Sends a formatted line to a client. Whatever the socket can't take
+ * straight away is kept and sent when it has room.
+ *
+ * @param server Server state
+ * @param conn Connection to send to
+ * @param format printf style format of line, including its newline
+ */
+void send_line(Server* server, Connection* conn, const char* format, ...) {
+    if (conn == NULL || conn->closed) {
+        return;
+    }
+
+    char line[MAX_LINE_LENGTH + 2];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    if (length < 0) {
+        return;
+    } else if (length >= sizeof(line)) {
+        length = sizeof(line) - 1;
+    }
+
+    if (conn->outputUsed + length > conn->outputCapacity) {
+        conn->outputCapacity = (conn->outputUsed + length) * 2;
+        conn->output = realloc(conn->output, conn->outputCapacity);
+    }
+    memcpy(conn->output + conn->outputUsed, line, length);
+    conn->outputUsed += length;
+
+    // Only try now if nothing was already waiting for the socket
+    if (conn->outputUsed == length) {
+        flush_output(server, conn);
+    }
+}
+
+/*
+ * Sends as much of a client's waiting output as its socket will take, and
+ * watches for room in the socket if any is left. Closes the connection if
+ * it is finished with and everything has been sent. If the socket is
+ * broken, the output is dropped and the error event epoll reports for the
+ * socket closes the connection, so matches are never ended from here.
+ *
+ * @param server Server state
+ * @param conn Connection to send to
+ */
+void flush_output(Server* server, Connection* conn) {
+    long sent = 0;
+    while (sent < conn->outputUsed) {
+        long result = send(conn->fd, conn->output + sent,
+                conn->outputUsed - sent, MSG_NOSIGNAL);
+        if (result == -1 && errno == EINTR) {
+            continue;
+        } else if (result == -1 && errno == EAGAIN) {
+            break;
+        } else if (result <= 0) {
+            sent = conn->outputUsed;
+            break;
+        }
+        sent += result;
+    }
+
+    memmove(conn->output, conn->output + sent, conn->outputUsed - sent);
+    conn->outputUsed -= sent;
+
+    bool needsRoom = (conn->outputUsed > 0);
+    if (needsRoom != conn->watchingOutput) {
+        struct epoll_event event = {.events = EPOLLIN, .data.ptr = conn};
+        event.events |= needsRoom ? EPOLLOUT : 0;
+        epoll_ctl(server->epollFd, EPOLL_CTL_MOD, conn->fd, &event);
+        conn->watchingOutput = needsRoom;
+    }
+
+    if (conn->outputUsed == 0 && conn->closeWhenSent) {
+        close_connection(server, conn);
+    }
+}
+
+/*
+ * Disconnects a client. If it was in a match that hasn't finished, its
+ * opponent wins. The connection is freed after the current batch of
+ * events.
+ *
+ * @param server Server state
+ * @param conn Connection to close
+ */
+void close_connection(Server* server, Connection* conn) {
+    if (conn->closed) {
+        return;
+    }
+    conn->closed = true;
+    epoll_ctl(server->epollFd, EPOLL_CTL_DEL, conn->fd, NULL);
+    close(conn->fd);
+
+    if (server->waiting == conn) {
+        server->waiting = NULL;
+    }
+    if (conn->match != NULL) {
+        Match* match = conn->match;
+        match->players[conn->player] = NULL;
+        end_match(server, match, !conn->player);
+    }
+
+    conn->nextClosed = server->closedList;
+    server->closedList = conn;
+}
+
+/*
+ * Hands out memory from a match's arena.
+ *
+ * @param arena Arena to allocate from
+ * @param size Number of bytes needed
+ * @return Memory, aligned for any type, or NULL if the arena is full
+ */
+void* arena_alloc(Arena* arena, long size) {
+    long start = (arena->used + 15) & ~15L;
+    if (start + size > arena->size) {
+        return NULL;
+    }
+
+    arena->used = start + size;
+    return arena->base + start;
+}
+
+/*
+ * Starts a match between two clients, telling each which player they are
+ * and the size of the grid, then starts the first player's turn.
+ * The match and its grid live in one arena, freed when the match ends.
+ *
+ * @param server Server state
+ * @param first Client who plays first ('*')
+ * @param second Client who plays second ('#')
+ */
+void start_match(Server* server, Connection* first, Connection* second) {
+    long cells = (long) server->height * server->width;
+    Arena arena = {NULL, 0, sizeof(Match) + cells + 32};
+    arena.base = malloc(arena.size);
+
+    Match* match = arena_alloc(&arena, sizeof(Match));
+    memset(match, 0, sizeof(Match));
+    match->arena = arena;
+    match->cells = arena_alloc(&match->arena, cells);
+    memset(match->cells, EMPTY_GRID_CELL, cells);
+
+    Connection* players[2] = {first, second};
+    for (int player = 0; player < 2; player++) {
+        match->players[player] = players[player];
+        players[player]->match = match;
+        players[player]->player = player;
+    }
+    for (int player = 0; player < 2; player++) {
+        send_line(server, players[player], "game %c %d %d\n",
+                PLAYER_SYMBOL(player), server->height, server->width);
+    }
+
+    server->matchesStarted++;
+    begin_turn(server, match);
+}
+
+/*
+ * Starts the current player's turn, or ends the match if their tile
+ * can't be placed anywhere.
+ *
+ * @param server Server state
+ * @param match Match to start turn in
+ */
+void begin_turn(Server* server, Match* match) {
+    int row, column, rotation;
+    if (!find_first_fit(match->cells, server->height, server->width,
+            server->rotations[match->currentTile], &row, &column,
+            &rotation)) {
+        end_match(server, match, !match->currentPlayer);
+        return;
+    }
+
+    send_line(server, match->players[match->currentPlayer], "yourturn %d\n",
+            match->currentTile);
+}
+
+/*
+ * Handles a line sent by a client. On the client's turn, a valid move
+ * ("row column rotation") is made and sent to both players, then the
+ * other player's turn starts. Anything else is answered with "invalid".
+ *
+ * @param server Server state
+ * @param conn Client that sent the line
+ * @param line Line sent, without its newline
+ */
+void handle_line(Server* server, Connection* conn, char* line) {
+    Match* match = conn->match;
+    int row, column, rotation;
+    char extra;
+
+    if (match == NULL || match->currentPlayer != conn->player
+            || sscanf(line, "%d %d %d%c", &row, &column, &rotation,
+            &extra) != 3 || (rotation != 0 && rotation != 90
+            && rotation != 180 && rotation != 270)
+            || !does_tile_fit(match->cells, server->height, server->width,
+            server->rotations[match->currentTile][rotation / 90], row,
+            column)) {
+        send_line(server, conn, "invalid\n");
+        return;
+    }
+
+    put_tile(match->cells, server->height, server->width,
+            server->rotations[match->currentTile][rotation / 90], row, column,
+            PLAYER_SYMBOL(conn->player));
+    for (int player = 0; player < 2; player++) {
+        send_line(server, match->players[player], "move %c %d %d %d %d\n",
+                PLAYER_SYMBOL(conn->player), match->currentTile, row, column,
+                rotation);
+    }
+
+    match->currentPlayer = !match->currentPlayer;
+    match->currentTile = (match->currentTile + 1) % server->numTiles;
+    begin_turn(server, match);
+}
+
+/*
+ * Ends a match, telling both players (if still connected) who won.
+ * Each player is disconnected once everything sent to them has gone, and
+ * the match's arena is freed.
+ *
+ * @param server Server state
+ * @param match Match to end
+ * @param winner Player who won
+ */
+void end_match(Server* server, Match* match, int winner) {
+    for (int player = 0; player < 2; player++) {
+        Connection* conn = match->players[player];
+        if (conn == NULL) {
+            continue;
+        }
+        send_line(server, conn, "winner %c\n", PLAYER_SYMBOL(winner));
+        conn->match = NULL;
+        conn->closeWhenSent = true;
+        if (!conn->closed && conn->outputUsed == 0) {
+            close_connection(server, conn);
+        }
+    }
+
+    server->matchesFinished++;
+    free(match->arena.base);
+}
@@ -0,0 +1,376 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <ctype.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include "lib/tiles.h"
+
+/* Exit status codes */
+#define ERROR_INCORRECT_ARGS 1
+#define ERROR_TILEFILE_UNREADABLE 2
+#define ERROR_TILEFILE_INVALID 3
+#define ERROR_CONNECT 6
+
+#define MAX_EVENTS 256
+#define MAX_LINE_LENGTH 70
+#define DEFAULT_PAIRS 16
+
+/*
+ * A bot playing one match on the server
+ *  - fd: Socket connected to the server
+ *  - symbol: Player symbol the bot was given
+ *  - height, width: Size of the match's grid
+ *  - cells: Bot's copy of the grid, height * width cells in row order
+ *  - input: Bytes received that aren't a whole line yet
+ *  - inputUsed: Number of bytes in input
+ *  - moveSent: Time (ns) the bot's last move was sent
+ */
+typedef struct {
+    int fd;
+    char symbol;
+    int height;
+    int width;
+    char* cells;
+    char input[MAX_LINE_LENGTH + 2];
+    int inputUsed;
+    long long moveSent;
+} Bot;
+
+/*
+ * State of a load test
+ *  - address: Port or socket path of the server
+ *  - numTiles: Number of tiles in the tile cycle
+ *  - rotations: Every tile at every rotation
+ *  - epollFd: Epoll instance watching every bot's socket
+ *  - botsToStart: Number of bots still to connect
+ *  - botsRunning: Number of bots connected
+ *  - matches: Number of matches finished (two bots each)
+ *  - errors: Number of moves the server rejected, or lost connections
+ *  - latencies: Time (ns) from sending each move to being told it was made
+ *  - numLatencies: Number of latencies recorded
+ *  - latencyCapacity: Number of latencies there is room for
+ */
+typedef struct {
+    char* address;
+    int numTiles;
+    char (*rotations)[4][TILE_SIZE][TILE_SIZE];
+    int epollFd;
+    long botsToStart;
+    long botsRunning;
+    long matches;
+    long errors;
+    long long* latencies;
+    long numLatencies;
+    long latencyCapacity;
+} LoadTest;
+
+long long get_clock_ns(void);
+int connect_to_server(char* address);
+bool start_bot(LoadTest* test);
+void stop_bot(LoadTest* test, Bot* bot);
+void read_bot(LoadTest* test, Bot* bot);
+bool handle_bot_line(LoadTest* test, Bot* bot, char* line);
+int compare_latencies(const void* a, const void* b);
+void print_results(LoadTest* test, long long elapsed);
+
+int main(int argc, char** argv) {
+    if (argc != 4 && argc != 5) {
+        fprintf(stderr, "Usage: fitzload tilefile port|socketpath matches "
+                "[concurrent]\n");
+        return ERROR_INCORRECT_ARGS;
+    }
+
+    LoadTest test;
+    memset(&test, 0, sizeof(LoadTest));
+    test.address = argv[2];
+    test.numTiles = count_tiles(argv[1]);
+    if (test.numTiles == TILEFILE_UNREADABLE) {
+        fprintf(stderr, "Can't access tile file\n");
+        return ERROR_TILEFILE_UNREADABLE;
+    } else if (test.numTiles == TILEFILE_INVALID) {
+        fprintf(stderr, "Invalid tile file contents\n");
+        return ERROR_TILEFILE_INVALID;
+    }
+
+    char* end;
+    long matches = strtol(argv[3], &end, 10);
+    long pairs = DEFAULT_PAIRS;
+    if (*end != '\0' || matches < 1) {
+        fprintf(stderr, "Usage: fitzload tilefile port|socketpath matches "
+                "[concurrent]\n");
+        return ERROR_INCORRECT_ARGS;
+    }
+    if (argc == 5) {
+        pairs = strtol(argv[4], &end, 10);
+        if (*end != '\0' || pairs < 1) {
+            fprintf(stderr, "Usage: fitzload tilefile port|socketpath "
+                    "matches [concurrent]\n");
+            return ERROR_INCORRECT_ARGS;
+        }
+    }
+
+    char tiles[test.numTiles][TILE_SIZE][TILE_SIZE];
+    load_tiles(argv[1], test.numTiles, tiles);
+    test.rotations = malloc(sizeof(*test.rotations) * test.numTiles);
+    for (int tile = 0; tile < test.numTiles; tile++) {
+        for (int i = 0; i < 4; i++) {
+            rotate_tile(tiles[tile], test.rotations[tile][i], i * 90);
+        }
+    }
+
+    // The server pairs bots in the order they connect
+    test.epollFd = epoll_create1(0);
+    test.botsToStart = 2 * matches;
+    long long start = get_clock_ns();
+    for (long i = 0; i < 2 * pairs && test.botsToStart > 0; i++) {
+        if (!start_bot(&test)) {
+            fprintf(stderr, "Unable to connect to %s\n", test.address);
+            return ERROR_CONNECT;
+        }
+    }
+
+    struct epoll_event events[MAX_EVENTS];
+    while (test.botsRunning > 0) {
+        int numEvents = epoll_wait(test.epollFd, events, MAX_EVENTS, -1);
+        for (int i = 0; i < numEvents; i++) {
+            read_bot(&test, events[i].data.ptr);
+        }
+    }
+
+    print_results(&test, get_clock_ns() - start);
+    return 0;
+}
+
+/*
+ * Gets the time from a monotonic clock.
+ *
+ * @return Time in nanoseconds since an arbitrary starting point
+ */
+long long get_clock_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+/*
+ * Connects to the server. An address made only of digits is a TCP port on
+ * this machine, anything else is the path of a UNIX socket.
+ *
+ * @param address Port or socket path to connect to
+ * @return Connected socket, or -1 if it couldn't connect
+ */
+int connect_to_server(char* address) {
+    bool isPort = (*address != '\0');
+    for (char* pos = address; *pos != '\0'; pos++) {
+        isPort = isPort && isdigit(*pos);
+    }
+
+    int fd;
+    if (isPort) {
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(atoi(address));
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd == -1 || connect(fd, (struct sockaddr*) &addr,
+                sizeof(addr)) == -1) {
+            return -1;
+        }
+        int noDelay = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+    } else {
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        strncpy(addr.sun_path, address, sizeof(addr.sun_path) - 1);
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd == -1 || connect(fd, (struct sockaddr*) &addr,
+                sizeof(addr)) == -1) {
+            return -1;
+        }
+    }
+
+    return fd;
+}
+
+/*
+ * Connects a new bot to the server.
+ *
+ * @param test Load test state
+ * @return true if connected, false otherwise
+ */
+bool start_bot(LoadTest* test) {
+    int fd = connect_to_server(test->address);
+    if (fd == -1) {
+        return false;
+    }
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+
+    Bot* bot = calloc(1, sizeof(Bot));
+    bot->fd = fd;
+    struct epoll_event event = {.events = EPOLLIN, .data.ptr = bot};
+    epoll_ctl(test->epollFd, EPOLL_CTL_ADD, fd, &event);
+
+    test->botsToStart--;
+    test->botsRunning++;
+    return true;
+}
+
+/*
+ * Disconnects a bot whose match is over, and connects another in its
+ * place if more matches are still to be played.
+ *
+ * @param test Load test state
+ * @param bot Bot to stop
+ */
+void stop_bot(LoadTest* test, Bot* bot) {
+    epoll_ctl(test->epollFd, EPOLL_CTL_DEL, bot->fd, NULL);
+    close(bot->fd);
+    free(bot->cells);
+    free(bot);
+    test->botsRunning--;
+
+    if (test->botsToStart > 0 && !start_bot(test)) {
+        test->errors++;
+        test->botsToStart--;
+    }
+}
+
+/*
+ * Reads what the server sent a bot and handles each complete line.
+ *
+ * @param test Load test state
+ * @param bot Bot with data waiting
+ */
+void read_bot(LoadTest* test, Bot* bot) {
+    char buffer[4096];
+    long bytesRead = recv(bot->fd, buffer, sizeof(buffer), 0);
+    if (bytesRead == -1 && (errno == EAGAIN || errno == EINTR)) {
+        return;
+    } else if (bytesRead <= 0) {
+        test->errors++;
+        stop_bot(test, bot);
+        return;
+    }
+
+    for (long i = 0; i < bytesRead; i++) {
+        if (buffer[i] != '\n') {
+            if (bot->inputUsed <= MAX_LINE_LENGTH) {
+                bot->input[bot->inputUsed++] = buffer[i];
+            }
+            continue;
+        }
+        bot->input[bot->inputUsed] = '\0';
+        bot->inputUsed = 0;
+        if (!handle_bot_line(test, bot, bot->input)) {
+            stop_bot(test, bot);
+            return;
+        }
+    }
+}
+
+/*
+ * Handles a line the server sent a bot. The bot keeps its own copy of the
+ * grid from the moves it is told about, and plays the first placement that
+ * fits when it is its turn.
+ *
+ * @param test Load test state
+ * @param bot Bot the line was sent to
+ * @param line Line sent, without its newline
+ * @return false if the bot's match is over, true otherwise
+ */
+bool handle_bot_line(LoadTest* test, Bot* bot, char* line) {
+    char symbol;
+    int tile, row, column, rotation;
+
+    if (sscanf(line, "game %c %d %d", &bot->symbol, &bot->height,
+            &bot->width) == 3) {
+        bot->cells = malloc((long) bot->height * bot->width);
+        memset(bot->cells, EMPTY_GRID_CELL, (long) bot->height * bot->width);
+    } else if (sscanf(line, "yourturn %d", &tile) == 1) {
+        find_first_fit(bot->cells, bot->height, bot->width,
+                test->rotations[tile % test->numTiles], &row, &column,
+                &rotation);
+        char move[MAX_LINE_LENGTH];
+        int length = sprintf(move, "%d %d %d\n", row, column, rotation);
+        bot->moveSent = get_clock_ns();
+        send(bot->fd, move, length, MSG_NOSIGNAL);
+    } else if (sscanf(line, "move %c %d %d %d %d", &symbol, &tile, &row,
+            &column, &rotation) == 5) {
+        put_tile(bot->cells, bot->height, bot->width,
+                test->rotations[tile % test->numTiles][rotation / 90 % 4],
+                row, column, symbol);
+        if (symbol != bot->symbol) {
+            return true;
+        }
+        if (test->numLatencies == test->latencyCapacity) {
+            test->latencyCapacity = test->latencyCapacity * 2 + 1024;
+            test->latencies = realloc(test->latencies,
+                    sizeof(long long) * test->latencyCapacity);
+        }
+        test->latencies[test->numLatencies++] =
+                get_clock_ns() - bot->moveSent;
+    } else if (sscanf(line, "winner %c", &symbol) == 1) {
+        // Each match's result is sent to both its bots
+        if (bot->symbol == '*') {
+            test->matches++;
+        }
+        return false;
+    } else {
+        test->errors++;
+    }
+
+    return true;
+}
+
+/*
+ * Compares two latencies, for sorting in increasing order.
+ *
+ * @param a First latency
+ * @param b Second latency
+ * @return Negative if a < b, positive if a > b, 0 if equal
+ */
+int compare_latencies(const void* a, const void* b) {
+    long long first = *(const long long*) a;
+    long long second = *(const long long*) b;
+    return (first > second) - (first < second);
+}
+
+/*
+ * Prints matches per second and move latency percentiles (in microseconds).
+ *
+ * @param test Load test state, once every bot has finished
+ * @param elapsed Time (ns) the load test took
+ */
+void print_results(LoadTest* test, long long elapsed) {
+    double seconds = elapsed / 1e9;
+    printf("%ld matches in %.3f s (%.1f matches/s), %ld errors\n",
+            test->matches, seconds, test->matches / seconds, test->errors);
+    if (test->numLatencies == 0) {
+        return;
+    }
+
+    qsort(test->latencies, test->numLatencies, sizeof(long long),
+            compare_latencies);
+    long long total = 0;
+    for (long i = 0; i < test->numLatencies; i++) {
+        total += test->latencies[i];
+    }
+    long n = test->numLatencies;
+    printf("%ld moves (%.0f moves/s), latency us: mean %.1f p50 %.1f "
+            "p99 %.1f max %.1f\n", n, n / seconds, total / 1e3 / n,
+            test->latencies[n / 2] / 1e3, test->latencies[n * 99 / 100] / 1e3,
+            test->latencies[n - 1] / 1e3);
+}
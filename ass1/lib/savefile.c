@@ -0,0 +1,160 @@
+#include "savefile.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdint.h>
+
+/* Byte with the given value in every byte of a 64 bit word */
+#define EVERY_BYTE(x) (0x0101010101010101ULL * (unsigned char) (x))
+#define HIGH_BITS EVERY_BYTE(0x80)
+#define LOW_BITS EVERY_BYTE(0x7F)
+
+/*
+ * Checks the contents of a savefile are valid: a line of four integers
+ * (next tile, next player, height, width), then exactly height rows of
+ * width cells, each ended by a newline.
+ *
+ * @param data Contents of savefile
+ * @param size Number of bytes in data
+ * @param numTiles Number of tiles the savefile is played with, so the next
+ *                 tile must be less than it, or 0 if unknown
+ * @param save Destination to store the savefile's details if valid
+ * @param line Set to the line the problem is on, or 0 if not on one line
+ * @return Description of the first problem found, or NULL if valid
+ */
+const char* check_savefile_contents(const char* data, long size,
+        int numTiles, Savefile* save, int* line) {
+    *line = 1;
+    const char* pos = (size > 0) ? memchr(data, '\n', size) : NULL;
+    if (pos == NULL || pos - data >= SAVEFILE_HEADER_LENGTH) {
+        return "invalid header";
+    }
+
+    char header[SAVEFILE_HEADER_LENGTH];
+    memcpy(header, data, pos - data);
+    header[pos - data] = '\0';
+    if (!is_valid_input_line(header, 4)) {
+        return "invalid header";
+    }
+    sscanf(header, "%d %d %d %d", &save->nextTile, &save->currentPlayer,
+            &save->height, &save->width);
+
+    if (save->currentPlayer != 0 && save->currentPlayer != 1) {
+        return "invalid next player";
+    }
+    if (save->height < 1 || save->height > MAX_BOARD_SIZE
+            || save->width < 1 || save->width > MAX_BOARD_SIZE) {
+        return "invalid dimensions";
+    }
+    if (save->nextTile < 0 || (numTiles > 0 && save->nextTile >= numTiles)) {
+        return "invalid next tile";
+    }
+
+    save->grid = ++pos;
+    for (int row = 0; row < save->height; row++) {
+        *line = row + 2;
+        if (data + size - pos < save->width + 1) {
+            return "missing grid rows";
+        }
+        if (!is_valid_row(pos, save->width)) {
+            return "invalid grid cell";
+        }
+        if (pos[save->width] != '\n') {
+            return "grid row too long";
+        }
+        pos += save->width + 1;
+    }
+
+    if (pos != data + size) {
+        *line = save->height + 2;
+        return "unexpected data after grid";
+    }
+
+    *line = 0;
+    return NULL;
+}
+
+/*
+ * Checks every cell of a grid row is '.', '*' or '#'. Eight cells are
+ * checked at a time: a byte of (word ^ EVERY_BYTE(c)) is zero exactly
+ * where the cell is c, and zero bytes are found without carries between
+ * bytes, so each word takes a handful of instructions and no branches.
+ *
+ * @param row Cells of the row
+ * @param width Number of cells in the row
+ * @return true if all cells are valid, false otherwise
+ */
+bool is_valid_row(const char* row, int width) {
+    int column = 0;
+
+    for (; column + 8 <= width; column += 8) {
+        uint64_t word;
+        memcpy(&word, row + column, 8);
+
+        uint64_t valid = 0;
+        const char cells[3] = {'.', '*', '#'};
+        for (int i = 0; i < 3; i++) {
+            uint64_t diff = word ^ EVERY_BYTE(cells[i]);
+            // High bit of each byte is set if that byte of diff is non-zero
+            uint64_t nonZero = ((diff & LOW_BITS) + LOW_BITS) | diff;
+            valid |= ~nonZero & HIGH_BITS;
+        }
+        if (valid != HIGH_BITS) {
+            return false;
+        }
+    }
+
+    for (; column < width; column++) {
+        char curr = row[column];
+        if (curr != '.' && curr != '#' && curr != '*') {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*
+ * Checks a given input is a space delimited line of a specified amount of
+ * integers with no trailing or leading whitespace. Integers can only have
+ * one space between them.
+ *
+ * For example ("1 1 0", 3), ("-1 0 2 4", 4) is valid,
+ * but ("1 1 0", 2), (" 1 1 0 ", 3), ("2.0 0 0", 3), ("2    2 0", 3) are not.
+ *
+ * @param input Input to check
+ * @param numInputs Number of separated inputs if line is to be valid
+ * @return true if valid, false otherwise
+ */
+bool is_valid_input_line(char* input, int numInputs) {
+    int inputLength = strlen(input);
+
+    // If empty, or leading or trailing whitespace, invalid
+    if (inputLength == 0 || isspace(input[0])
+            || isspace(input[inputLength - 1])) {
+        return false;
+    }
+
+    int inputCount = 1;
+
+    for (int i = 0; i < inputLength; i++) {
+        if (isspace(input[i])) {
+            // two spaces in a row means invalid.
+            if (isspace(input[i + 1])) {
+                return false;
+            }
+            inputCount++;
+        } else if (input[i] == '-') {
+            // A negative sign must start a number and be followed by a digit
+            if ((i > 0 && !isspace(input[i - 1])) || !isdigit(input[i + 1])) {
+                return false;
+            }
+        } else if (!isdigit(input[i])) {
+            // Not a space, minus sign, or digit, therefore invalid
+            return false;
+        }
+    }
+
+    return inputCount == numInputs;
+}
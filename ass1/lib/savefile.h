@@ -0,0 +1,34 @@
+#include <stdbool.h>
+
+#ifndef SAVEFILE_H
+#define SAVEFILE_H
+
+#define MAX_BOARD_SIZE 999
+
+/* Longest savefile header line, including its terminator */
+#define SAVEFILE_HEADER_LENGTH 100
+
+/*
+ * Header details of a valid savefile
+ *  - nextTile: Tile to be placed next
+ *  - currentPlayer: Player to move next (0 or 1)
+ *  - height, width: Size of the grid
+ *  - grid: First grid row, within the savefile's contents. Rows are
+ *    width cells, each row followed by a newline.
+ */
+typedef struct {
+    int nextTile;
+    int currentPlayer;
+    int height;
+    int width;
+    const char* grid;
+} Savefile;
+
+const char* check_savefile_contents(const char* data, long size,
+        int numTiles, Savefile* save, int* line);
+
+bool is_valid_row(const char* row, int width);
+
+bool is_valid_input_line(char* input, int numInputs);
+
+#endif
@@ -0,0 +1,215 @@
+#include "tiles.h"
+#include <stdbool.h>
+#include <stdio.h>
+
+/*
+ * Checks the tilefile is valid and counts how many tiles are in it.
+ * A valid tilefile must contain exactly TILE_SIZE rows of TILE_SIZE length,
+ * with each row ending in \n. Tiles must be separated by an extra \n.
+ *
+ * @param filename Path to tilefile to check
+ * @return Number of tiles in the tilefile, TILEFILE_UNREADABLE if it can't
+ *         be opened, or TILEFILE_INVALID if it is invalid
+ */
+int count_tiles(char* filename) {
+    FILE* file = fopen(filename, "r");
+    if (file == NULL) {
+        return TILEFILE_UNREADABLE;
+    }
+
+    int numTiles = 0;
+    int curr;
+
+    while (true) {
+        for (int row = 0; row < TILE_SIZE; row++) {
+            // Check there exactly TILE_SIZE valid characters in row
+            for (int column = 0; column < TILE_SIZE; column++) {
+                curr = fgetc(file);
+                if (curr != EMPTY_TILE_CELL && curr != OCCUPIED_TILE_CELL) {
+                    fclose(file);
+                    return TILEFILE_INVALID;
+                }
+            }
+            // Next character must be newline
+            if (fgetc(file) != '\n') {
+                fclose(file);
+                return TILEFILE_INVALID;
+            }
+        }
+        numTiles++;
+
+        curr = fgetc(file);
+        if (curr == EOF) { // If file is finished, exit loop and return
+            break;
+        } else if (curr != '\n') { // If not finished, \n must seperate tiles
+            fclose(file);
+            return TILEFILE_INVALID;
+        }
+    }
+
+    fclose(file);
+    return numTiles;
+}
+
+/*
+ * Loads tilefile at specified filename into the given tiles array.
+ * This function assumes the tilefile is already checked to be valid
+ * and it is already known how many tiles are in the tilefile.
+ *
+ * @param filename Path of tilefile to load
+ * @param numTiles Number of tiles in the tilefile
+ * @param tiles Destination to store tiles loaded from file
+ * @return true if loaded, false if the tilefile can't be opened
+ */
+bool load_tiles(char* filename, int numTiles,
+        char tiles[numTiles][TILE_SIZE][TILE_SIZE]) {
+    FILE* file = fopen(filename, "r");
+    if (file == NULL) {
+        return false;
+    }
+
+    for (int tile = 0; tile < numTiles; tile++) {
+        for (int row = 0; row < TILE_SIZE; row++) {
+            for (int column = 0; column < TILE_SIZE; column++) {
+                tiles[tile][row][column] = fgetc(file);
+            }
+            // flush newline character between rows
+            fgetc(file);
+        }
+        // flush blank newline between each tile
+        fgetc(file);
+    }
+
+    fclose(file);
+    return true;
+}
+
+/*
+ * Rotates given tile specified number of degrees and stores it in destTile
+ * If given degrees is 0, tile be copied to destTile
+ *
+ * @param tile Original tile to be rotated
+ * @param destTile Destination where rotated tile will be stored
+ * @param degrees Number of degrees to rotate (divisible by 90).
+ */
+void rotate_tile(char tile[TILE_SIZE][TILE_SIZE],
+        char destTile[TILE_SIZE][TILE_SIZE], int degrees) {
+    int numRotations = degrees / 90;
+    char tempTile[TILE_SIZE][TILE_SIZE];
+
+    // Copy tile to destTile. Used for if degrees == 0
+    for (int i = 0; i < TILE_SIZE; i++) {
+        for (int j = 0; j < TILE_SIZE; j++) {
+            destTile[i][j] = tile[i][j];
+        }
+    }
+
+    for (int iteration = 0; iteration < numRotations; iteration++) {
+        // Copy tile to a temp location array.
+        // This allows for rotation multiple times.
+        for (int i = 0; i < TILE_SIZE; i++) {
+            for (int j = 0; j < TILE_SIZE; j++) {
+                tempTile[i][j] = destTile[i][j];
+            }
+        }
+
+        // Rotate tempTile 90 degrees and store in destTIle
+        for (int i = 0; i < TILE_SIZE; i++) {
+            for (int j = 0; j < TILE_SIZE; j++) {
+                destTile[i][j] = tempTile[(TILE_SIZE - 1) - j][i];
+            }
+        }
+    }
+}
+
+/*
+ * Checks whether the given tile can be placed on a grid stored as
+ * height * width cells in row order, with the same rules as fitz.
+ *
+ * @param cells Grid cells, EMPTY_GRID_CELL where empty
+ * @param height Height of grid
+ * @param width Width of grid
+ * @param tile Tile to place (already rotated)
+ * @param row Row where middle of tile will be placed (starting at 0)
+ * @param column Column where middle of tile will be placed (starting at 0)
+ * @return true if valid placement, false otherwise
+ */
+bool does_tile_fit(char* cells, int height, int width,
+        char tile[TILE_SIZE][TILE_SIZE], int row, int column) {
+    if (column >= width + 2 || row >= height + 2 || column < -2
+            || row < -2) {
+        return false;
+    }
+
+    for (int i = 0; i < TILE_SIZE; i++) {
+        for (int j = 0; j < TILE_SIZE; j++) {
+            if (tile[i][j] == EMPTY_TILE_CELL) {
+                continue;
+            }
+            int y = row - 2 + i, x = column - 2 + j;
+            if (x < 0 || y < 0 || x >= width || y >= height
+                    || cells[y * width + x] != EMPTY_GRID_CELL) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+/*
+ * Places given tile on a grid stored as height * width cells in row order.
+ * Assumes the placement is valid.
+ *
+ * @param cells Grid cells
+ * @param height Height of grid
+ * @param width Width of grid
+ * @param tile Tile to place (already rotated)
+ * @param row Row where middle of tile will be placed (starting at 0)
+ * @param column Column where middle of tile will be placed (starting at 0)
+ * @param symbol Player symbol to fill covered cells with
+ */
+void put_tile(char* cells, int height, int width,
+        char tile[TILE_SIZE][TILE_SIZE], int row, int column, char symbol) {
+    for (int i = 0; i < TILE_SIZE; i++) {
+        for (int j = 0; j < TILE_SIZE; j++) {
+            int y = row - 2 + i, x = column - 2 + j;
+            if (tile[i][j] != EMPTY_TILE_CELL && x >= 0 && y >= 0
+                    && x < width && y < height) {
+                cells[y * width + x] = symbol;
+            }
+        }
+    }
+}
+
+/*
+ * Finds the first valid placement of a tile in row, column, rotation
+ * order, the order fitz's is_game_over searches in.
+ *
+ * @param cells Grid cells
+ * @param height Height of grid
+ * @param width Width of grid
+ * @param rotations Tile at each rotation (0, 90, 180, 270)
+ * @param row Set to row of placement found
+ * @param column Set to column of placement found
+ * @param rotation Set to degrees of rotation of placement found
+ * @return true if a placement was found, false if the tile fits nowhere
+ */
+bool find_first_fit(char* cells, int height, int width,
+        char rotations[4][TILE_SIZE][TILE_SIZE], int* row, int* column,
+        int* rotation) {
+    for (int y = -2; y < height + 2; y++) {
+        for (int x = -2; x < width + 2; x++) {
+            for (int i = 0; i < 4; i++) {
+                if (does_tile_fit(cells, height, width, rotations[i], y, x)) {
+                    *row = y;
+                    *column = x;
+                    *rotation = i * 90;
+                    return true;
+                }
+            }
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,34 @@
+#include <stdbool.h>
+
+#ifndef TILES_H
+#define TILES_H
+
+#define TILE_SIZE 5
+
+#define EMPTY_TILE_CELL ','
+#define OCCUPIED_TILE_CELL '!'
+#define EMPTY_GRID_CELL '.'
+
+/* Errors returned by count_tiles */
+#define TILEFILE_UNREADABLE -1
+#define TILEFILE_INVALID -2
+
+int count_tiles(char* filename);
+
+bool load_tiles(char* filename, int numTiles,
+        char tiles[numTiles][TILE_SIZE][TILE_SIZE]);
+
+void rotate_tile(char tile[TILE_SIZE][TILE_SIZE],
+        char destTile[TILE_SIZE][TILE_SIZE], int degrees);
+
+bool does_tile_fit(char* cells, int height, int width,
+        char tile[TILE_SIZE][TILE_SIZE], int row, int column);
+
+void put_tile(char* cells, int height, int width,
+        char tile[TILE_SIZE][TILE_SIZE], int row, int column, char symbol);
+
+bool find_first_fit(char* cells, int height, int width,
+        char rotations[4][TILE_SIZE][TILE_SIZE], int* row, int* column,
+        int* rotation);
+
+#endif
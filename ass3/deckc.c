@@ -0,0 +1,113 @@
+#include "lib/game.h"
+#include "lib/match.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Represents a result/exit code from the deck compiler
+ */
+typedef enum {
+    NORMAL = 0,
+    WRONG_NUM_ARGS = 1,
+    DECKFILE_UNREADABLE = 2,
+    DECKFILE_INCORRECT = 3,
+    DECK_UNPACKABLE = 4,
+    OUTPUT_UNWRITABLE = 5
+} Result;
+
+/*
+ * Exits with given code, printing why to stderr.
+ *
+ * @param code Exit reason
+ */
+void exit_deckc(Result code) {
+    switch (code) {
+        case WRONG_NUM_ARGS:
+            fprintf(stderr, "Usage: deckc deckfile output"
+                    PACKED_DECK_SUFFIX "\n");
+            break;
+        case DECKFILE_UNREADABLE:
+            fprintf(stderr, "Cannot access deck file\n");
+            break;
+        case DECKFILE_INCORRECT:
+            fprintf(stderr, "Invalid deck file contents\n");
+            break;
+        case DECK_UNPACKABLE:
+            fprintf(stderr, "Deck has values or prices outside 0 to 255\n");
+            break;
+        case OUTPUT_UNWRITABLE:
+            fprintf(stderr, "Cannot write output file\n");
+            break;
+        default:
+            break;
+    }
+
+    exit(code);
+}
+
+/*
+ * Writes a binary deck. It is written to a temporary file first, then
+ * renamed over filename, so hubs that already have the old deck mapped
+ * keep their copy.
+ *
+ * @param filename Path to write binary deck to
+ * @param cards Cards to write, in order
+ * @param numCards Number of cards
+ * @return true if written, false if the file can't be written
+ */
+bool write_packed_deck(char* filename, PackedCard* cards, int numCards) {
+    char* tempName = malloc(strlen(filename) + sizeof(".tmp"));
+    sprintf(tempName, "%s.tmp", filename);
+
+    FILE* file = fopen(tempName, "wb");
+    if (file == NULL) {
+        free(tempName);
+        return false;
+    }
+
+    PackedDeckHeader header = {.numCards = numCards};
+    memcpy(header.magic, PACKED_DECK_MAGIC, sizeof(header.magic));
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1
+            && fwrite(cards, sizeof(PackedCard), numCards, file) == numCards;
+    written = (fclose(file) == 0) && written
+            && rename(tempName, filename) == 0;
+
+    if (!written) {
+        remove(tempName);
+    }
+    free(tempName);
+    return written;
+}
+
+int main(int argc, char** argv) {
+    if (argc != 3) {
+        exit_deckc(WRONG_NUM_ARGS);
+    }
+
+    // Check the deckfile as the hub would
+    Card* cards;
+    int numCards = read_deck_cards(argv[1], &cards);
+    if (numCards == DECK_UNREADABLE) {
+        exit_deckc(DECKFILE_UNREADABLE);
+    } else if (numCards == DECK_INVALID) {
+        exit_deckc(DECKFILE_INCORRECT);
+    }
+
+    PackedCard* packed = malloc(sizeof(PackedCard) * numCards);
+    for (int i = 0; i < numCards; i++) {
+        if (!pack_card(cards[i], &packed[i])) {
+            exit_deckc(DECK_UNPACKABLE);
+        }
+    }
+    free(cards);
+
+    if (!write_packed_deck(argv[2], packed, numCards)) {
+        exit_deckc(OUTPUT_UNWRITABLE);
+    }
+    free(packed);
+
+    return NORMAL;
+}
@@ -1,5 +1,6 @@
 #include "lib/util.h"
 #include "lib/game.h"
+#include "lib/match.h"
 
 #include <stdbool.h>
 #include <stdio.h>
@@ -9,6 +10,14 @@
 #include <fcntl.h>
 #include <stdarg.h>
 #include <signal.h>
+#include <spawn.h>
+#include <poll.h>
+#include <errno.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <sys/syscall.h>
+#include <sys/resource.h>
+#include <sys/epoll.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 
@@ -16,13 +25,21 @@
 #define READ_END 0
 #define WRITE_END 1
 
-/* Wait time before killing children after sending end of game */
-#define CHILD_KILL_WAIT 2
+/* Longest wait (ms) for children to exit after sending end of game */
+#define CHILD_KILL_WAIT 2000
+/* How often (ms) children without a pidfd are checked for having exited */
+#define CHILD_CHECK_INTERVAL 10
 
 #define MSG_WILD_TAKE "wild"
 #define MSG_TOKEN_TAKE "take"
 #define MSG_CARD_PURCHASE "purchase"
 
+/* Players given as paths ending in this are loaded with dlopen */
+#define PLUGIN_SUFFIX ".so"
+
+/* Most events handled per epoll_wait */
+#define EVENT_BATCH 64
+
 /*
  * Represents a result/exit code from the hub
  */
@@ -35,81 +52,378 @@ typedef enum {
     PLAYER_START_FAIL = 5,
     PLAYER_DISCONNECT = 6,
     BAD_PROTOCOL = 7,
+    PLAYER_TIMEOUT = 8,
     SIGINT_CAUGHT = 10
 } Result;
 
-// global game variable to allow use in signal handler
-Game* globalGame;
+/*
+ * A player loaded into the hub as a shared object instead of being run as
+ * a child process. Its choose_move is called directly with its own view of
+ * the game, and its move comes back through a callback.
+ * - impl: The player implementation
+ * - view: The game as the player would track it, with myId set
+ */
+typedef struct Plugin {
+    PlayerPlugin impl;
+    Game* view;
+} Plugin;
+
+/*
+ * A table the hub runs games at, one after another. The hub can run games
+ * at many tables at once, each moving along as its players reply.
+ * - game: The game state of the game at the table
+ * - id: Number of the game, starting at 1
+ * - deck: Cards in the deckfile, shared by every game
+ * - packedDeck: Cards of a binary deck, used instead of deck if not NULL
+ * - deckSize: Number of cards in deck
+ * - order: Order this game deals the deck in, or NULL to deal it in
+ *   deckfile order. Kept for the table's later games.
+ * - nextCard: Index in deck (or order) of the next card to face up
+ * - cardsLeft: Number of cards not yet faced up
+ * - curPlayer: Player whose turn it is
+ * - attempted: Whether curPlayer has already made an invalid move this turn
+ * - lastRound: Whether a player has reached maxPoints, so the game ends
+ *   after this round
+ * - waiting: Whether curPlayer has been sent "dowhat" and not yet replied
+ * - deadline: Clock time (see get_clock_ms) curPlayer must reply by,
+ *   or -1 for no limit
+ * - finished: Whether the game is over
+ * - result: How the game ended, once finished
+ */
+typedef struct {
+    Game* game;
+    int id;
+
+    Card* deck;
+    const PackedCard* packedDeck;
+    int deckSize;
+    int* order;
+    int nextCard;
+    int cardsLeft;
+
+    int curPlayer;
+    bool attempted;
+    bool lastRound;
+    bool waiting;
+    long long deadline;
+    bool finished;
+    Result result;
+} Table;
+
+/*
+ * Everything run by the hub.
+ * - deck: Cards in the deckfile, shared by every game
+ * - packedDeck: Cards of a binary deck mapped into memory, shared by every
+ *   game instead of deck
+ * - deckSize: Number of cards in deck
+ * - shuffled: Whether each game deals the deck in its own shuffled order
+ * - seed: Seed of every game's shuffle
+ * - paths: Paths of each player's executable or plugin
+ * - numPlayers: Number of players in each game
+ * - initialTokens: The initial number of tokens on board piles
+ * - maxPoints: The number of points a player needs to win
+ * - moveTimeout: Time (ms) a player has to reply to "dowhat", or -1 for
+ *   no limit
+ * - numGames: Number of games to run
+ * - numStarted: Number of games started so far
+ * - numTables: Number of tables games are run at
+ * - tables: The tables games are run at
+ * - retired: Games that ended early at a table that went on to another
+ *   game. Their players are kept here to be reaped when the hub is done.
+ * - numRetired: Number of games in retired
+ * - firstFailure: Lowest numbered game that didn't end normally, or 0
+ * - failure: How game firstFailure ended
+ * - epollFd: Watches player pipes of every table, see watch_player
+ */
+typedef struct {
+    Card* deck;
+    const PackedCard* packedDeck;
+    int deckSize;
+    bool shuffled;
+    unsigned long long seed;
+    char** paths;
+    int numPlayers;
+    int initialTokens;
+    int maxPoints;
+    int moveTimeout;
+
+    int numGames;
+    int numStarted;
+    int numTables;
+    Table* tables;
+    Table* retired;
+    int numRetired;
+    int firstFailure;
+    Result failure;
+
+    int epollFd;
+} Hub;
+
+// global hub variable to allow use in signal handler
+Hub* globalHub;
+
+// Environment passed on to player processes
+extern char** environ;
+
+/*
+ * Writes as much of a player's pending messages, followed by a new message,
+ * as their stdin pipe has room for. The rest is kept pending, to be written
+ * before the player's next message, or when read_player_line sees the pipe
+ * has room. If the player has gone, everything is thrown away (the hub
+ * finds out when it next reads from them).
+ *
+ * @param game The game struct
+ * @param playerId Player to write to
+ * @param message New message, or NULL to just write pending messages
+ * @param length Length of message
+ */
+void send_to_player(Game* game, int playerId, const char* message,
+        int length) {
+    Player* player = &game->players[playerId];
+    int fd = fileno(player->in);
+    struct iovec parts[2] = {{player->pending, player->pendingSize},
+            {(void*) message, (message == NULL) ? 0 : length}};
+
+    while (parts[0].iov_len + parts[1].iov_len > 0) {
+        ssize_t written = writev(fd, parts, 2);
+        if (written == -1 && (errno == EAGAIN || errno == EINTR)) {
+            break;
+        } else if (written == -1) {
+            parts[0].iov_len = parts[1].iov_len = 0; // Player has gone
+            break;
+        }
+
+        for (int i = 0; i < 2; i++) {
+            size_t used = (written < parts[i].iov_len)
+                    ? written : parts[i].iov_len;
+            parts[i].iov_base = (char*) parts[i].iov_base + used;
+            parts[i].iov_len -= used;
+            written -= used;
+        }
+    }
+
+    // Keep whatever couldn't be written, in order
+    int left = parts[0].iov_len + parts[1].iov_len;
+    if (left > player->pendingCapacity) {
+        player->pendingCapacity = left * 2;
+        char* pending = malloc(player->pendingCapacity);
+        memcpy(pending, parts[0].iov_base, parts[0].iov_len);
+        memcpy(pending + parts[0].iov_len, parts[1].iov_base,
+                parts[1].iov_len);
+        free(player->pending);
+        player->pending = pending;
+    } else if (left > 0) {
+        memmove(player->pending, parts[0].iov_base, parts[0].iov_len);
+        memcpy(player->pending + parts[0].iov_len, parts[1].iov_base,
+                parts[1].iov_len);
+    }
+    player->pendingSize = left;
+}
 
 /*
  * Sends a formatted message to all players in game.
+ * The message is formatted once, then written to each player's pipe
+ * without waiting for room (see send_to_player).
  *
  * @param game The game struct
  * @param format String format
  * @param args Formatting arguments
  */
 void send_message_all(Game* game, const char* format, ...) {
+    char message[BUFFER_SIZE];
     va_list args;
 
+    va_start(args, format);
+    int length = vsnprintf(message, BUFFER_SIZE, format, args);
+    va_end(args);
+    if (length >= BUFFER_SIZE) {
+        length = BUFFER_SIZE - 1;
+    }
+
     for (int i = 0; i < game->numPlayers; i++) {
-        va_start(args, format);
         if (game->players[i].in != NULL) {
-            vfprintf(game->players[i].in, format, args);
-            fflush(game->players[i].in);
+            send_to_player(game, i, message, length);
         }
     }
+}
+
+/*
+ * Prints a line of a game's output to stream. When the hub is running more
+ * than one game, the line is prefixed with the game's number.
+ *
+ * @param table The game the line is about
+ * @param stream Stream to print to
+ * @param format String format
+ * @param args Formatting arguments
+ */
+void print_game_line(Table* table, FILE* stream, const char* format, ...) {
+    va_list args;
 
+    if (globalHub->numGames > 1) {
+        fprintf(stream, "Game %d: ", table->id);
+    }
+    va_start(args, format);
+    vfprintf(stream, format, args);
     va_end(args);
 }
 
 /*
- * Ends game and kills player processes.
- * Prints winners, then sends "eog" to all players and waits 2 seconds.
- * If any processes haven't terminated yet, they will be sent SIGKILL.
+ * Gets the time from a monotonic clock.
+ *
+ * @return Time in milliseconds since an arbitrary starting point
+ */
+long long get_clock_ms(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000LL + now.tv_nsec / 1000000;
+}
+
+/*
+ * Waits until deadline for player processes to exit, reaping
+ * each as soon as it does. Each child is watched through a pidfd, which
+ * becomes readable when the child exits. Children a pidfd can't be opened
+ * for (on older kernels) are checked every CHILD_CHECK_INTERVAL ms.
+ * Messages still pending for a child (such as "eog") are written as its
+ * stdin pipe makes room, so a slow reader still gets to exit normally.
+ * Any still running at the deadline are killed with SIGKILL and reaped.
  *
  * @param game The game struct
- * @param code Exit code of hub
+ * @param exitStatuses Destination for each player's wait status
+ * @param deadline Clock time (see get_clock_ms) to stop waiting at
  */
-void kill_players(Game* game, Result code) {
-    if (code == NORMAL) {
-        char dest[60] = "";
-        get_winners(game, dest);
-        fprintf(stdout, "Winner(s) %s\n", dest);
+void reap_players(Game* game, int exitStatuses[], long long deadline) {
+    int numPlayers = game->numPlayers;
+    int pidfds[numPlayers];
+    bool running[numPlayers];
+    int numRunning = 0;
+
+    for (int i = 0; i < numPlayers; i++) {
+        running[i] = game->players[i].pid > 0;
+        pidfds[i] = running[i]
+                ? syscall(SYS_pidfd_open, game->players[i].pid, 0) : -1;
+        numRunning += running[i];
+    }
+
+    while (numRunning > 0) {
+        // Reap every child that has exited, and write what is pending for
+        // the rest
+        for (int i = 0; i < numPlayers; i++) {
+            if (running[i] && waitpid(game->players[i].pid,
+                    &exitStatuses[i], WNOHANG) != 0) {
+                running[i] = false;
+                numRunning--;
+            } else if (running[i] && game->players[i].pendingSize > 0) {
+                send_to_player(game, i, NULL, 0);
+            }
+        }
+
+        long long now = get_clock_ms();
+        if (numRunning == 0 || now >= deadline) {
+            break;
+        }
+
+        struct pollfd fds[numPlayers * 2];
+        int numFds = 0;
+        bool checkAgain = false;
+        for (int i = 0; i < numPlayers; i++) {
+            if (running[i] && pidfds[i] >= 0) {
+                fds[numFds++] = (struct pollfd) {pidfds[i], POLLIN, 0};
+            } else if (running[i]) {
+                checkAgain = true;
+            }
+            if (running[i] && game->players[i].pendingSize > 0) {
+                fds[numFds++] = (struct pollfd)
+                        {fileno(game->players[i].in), POLLOUT, 0};
+            }
+        }
+        int timeout = deadline - now;
+        if (checkAgain && timeout > CHILD_CHECK_INTERVAL) {
+            timeout = CHILD_CHECK_INTERVAL;
+        }
+        poll(fds, numFds, timeout);
     }
 
-    // Can only send eog if some players have actually started up.
-    if (code == NORMAL || code >= PLAYER_START_FAIL) {
-        send_message_all(game, "eog\n");
+    for (int i = 0; i < numPlayers; i++) {
+        if (running[i]) {
+            // child still running. Kill it.
+            kill(game->players[i].pid, SIGKILL);
+            waitpid(game->players[i].pid, &exitStatuses[i], 0);
+        }
+        if (pidfds[i] >= 0) {
+            close(pidfds[i]);
+        }
     }
+}
 
-    // If no player processes were ever started, no more to do.
-    if (code != NORMAL && code < PLAYER_START_FAIL) {
-        return;
+/*
+ * Ends a game. Prints how it ended (the winners, if it ended normally).
+ * Its players are dealt with by finish_game.
+ *
+ * @param table The game to end
+ * @param result How the game ended
+ */
+void end_game(Table* table, Result result) {
+    table->finished = true;
+    table->result = result;
+
+    switch(result) {
+        case NORMAL: {
+            char dest[60] = "";
+            get_winners(table->game, dest);
+            print_game_line(table, stdout, "Winner(s) %s\n", dest);
+            break;
+        }
+        case PLAYER_DISCONNECT:
+            print_game_line(table, stdout, "Game ended due to disconnect\n");
+            fflush(stdout);
+            print_game_line(table, stderr, "Client disconnected\n");
+            break;
+        case BAD_PROTOCOL:
+            print_game_line(table, stderr, "Protocol error by client\n");
+            break;
+        case PLAYER_TIMEOUT:
+            print_game_line(table, stdout, "Game ended due to timeout\n");
+            fflush(stdout);
+            print_game_line(table, stderr, "Client timed out\n");
+            break;
+        default:
+            break;
     }
+}
 
-    // wait 2 seconds before attempting to kill any alive processes
-    sleep(CHILD_KILL_WAIT);
+/*
+ * Reaps the player processes of a game. Prints their exit statuses if the
+ * game ended early, unless the hub is exiting due to SIGINT.
+ *
+ * @param table Table the game was played at
+ * @param code Exit code of hub
+ * @param deadline Clock time (see get_clock_ms) to kill players still
+ *        running at
+ */
+void reap_game(Table* table, Result code, long long deadline) {
+    Game* game = table->game;
+    int exitStatuses[game->numPlayers];
+    reap_players(game, exitStatuses, deadline);
 
     for (int i = 0; i < game->numPlayers; i++) {
-        int pid = game->players[i].pid;
-        int exitStatus;
+        int exitStatus = exitStatuses[i];
 
-        if (waitpid(pid, &exitStatus, WNOHANG) == 0) {
-            // child still running. Kill it.
-            kill(pid, SIGKILL);
+        // Plugin players have no process to wait for
+        if (game->players[i].pid <= 0) {
+            continue;
         }
-        waitpid(pid, &exitStatus, WNOHANG); // get new exit status after kill
 
-        // Print exit statuses if all players started, and no sigint caught
-        if (code > PLAYER_START_FAIL && code != SIGINT_CAUGHT) {
+        // Print exit statuses if game ended early, and no sigint caught
+        if (table->result > PLAYER_START_FAIL && code != SIGINT_CAUGHT) {
             if (WIFEXITED(exitStatus)) {
                 if (WEXITSTATUS(exitStatus) != 0) {
-                    fprintf(stderr, "Player %c ended with status %d\n",
+                    print_game_line(table, stderr,
+                            "Player %c ended with status %d\n",
                             player_int_to_char(i), WEXITSTATUS(exitStatus));
                 }
             } else if (WIFSIGNALED(exitStatus)) {
-                fprintf(stderr, "Player %c shutdown after receiving "
-                        "signal %d\n",
+                print_game_line(table, stderr, "Player %c shutdown "
+                        "after receiving signal %d\n",
                         player_int_to_char(i), WTERMSIG(exitStatus));
             }
         }
@@ -117,17 +431,79 @@ void kill_players(Game* game, Result code) {
 }
 
 /*
- * Exits hub with given code.
- * Prints to stderr and shuts down players if neccessary.
+ * Kills player processes of every game.
+ * Sends "eog" to players of games not yet ended, then waits up to
+ * 2 seconds for all players to exit. If any processes haven't terminated
+ * by then, they will be sent SIGKILL.
+ *
+ * @param hub The hub
+ * @param code Exit code of hub
+ */
+void kill_players(Hub* hub, Result code) {
+    // If no player processes were ever started, no more to do.
+    if (code != NORMAL && code < PLAYER_START_FAIL) {
+        return;
+    }
+
+    // Games cut short by the hub exiting. Players that haven't started
+    // are skipped by send_message_all.
+    for (int t = 0; t < hub->numTables; t++) {
+        Table* table = &hub->tables[t];
+        if (table->game != NULL && !table->finished) {
+            table->finished = true;
+            table->result = code;
+            send_message_all(table->game, "eog\n");
+        }
+    }
+
+    // wait for players to exit, killing any still alive after 2 seconds
+    long long deadline = get_clock_ms() + CHILD_KILL_WAIT;
+    for (int i = 0; i < hub->numRetired; i++) {
+        reap_game(&hub->retired[i], code, deadline);
+    }
+    for (int t = 0; t < hub->numTables; t++) {
+        if (hub->tables[t].game != NULL) {
+            reap_game(&hub->tables[t], code, deadline);
+        }
+    }
+}
+
+/*
+ * Unloads every player plugin and frees their views of the game.
  *
  * @param game The game struct
+ */
+void unload_plugins(Game* game) {
+    if (game == NULL) {
+        return;
+    }
+
+    for (int i = 0; i < game->numPlayers; i++) {
+        Plugin* plugin = game->players[i].plugin;
+        if (plugin == NULL) {
+            continue;
+        }
+        close_player_plugin(&plugin->impl);
+        free_game(plugin->view);
+        free(plugin);
+        game->players[i].plugin = NULL;
+    }
+}
+
+/*
+ * Exits hub with given code.
+ * Prints to stderr and shuts down players of every game if neccessary.
+ * How each game ended is printed by end_game.
+ *
+ * @param hub The hub, or NULL if it hasn't been set up
  * @param code Exit reason
  */
-void exit_game(Game* game, Result code) {
+void exit_hub(Hub* hub, Result code) {
     switch(code) {
         case WRONG_NUM_ARGS:
-            fprintf(stderr, "Usage: austerity tokens points deck "
-                    "player player [player ...]\n");
+            fprintf(stderr, "Usage: austerity [--move-timeout ms] "
+                    "[--games n] [--parallel n] [--seed n] tokens points "
+                    "deck player player [player ...]\n");
             break;
         case INVALID_ARGS:
             fprintf(stderr, "Bad argument\n");
@@ -141,14 +517,6 @@ void exit_game(Game* game, Result code) {
         case PLAYER_START_FAIL:
             fprintf(stderr, "Bad start\n");
             break;
-        case PLAYER_DISCONNECT:
-            printf("Game ended due to disconnect\n");
-            fflush(stdout);
-            fprintf(stderr, "Client disconnected\n");
-            break;
-        case BAD_PROTOCOL:
-            fprintf(stderr, "Protocol error by client\n");
-            break;
         case SIGINT_CAUGHT:
             fprintf(stderr, "SIGINT caught\n");
             break;
@@ -156,27 +524,44 @@ void exit_game(Game* game, Result code) {
             break;
     }
 
-    kill_players(game, code);
-    free_game(game);
+    if (hub != NULL) {
+        kill_players(hub, code);
+        for (int i = 0; i < hub->numRetired; i++) {
+            unload_plugins(hub->retired[i].game);
+            free_game(hub->retired[i].game);
+        }
+        for (int t = 0; t < hub->numTables; t++) {
+            unload_plugins(hub->tables[t].game);
+            free_game(hub->tables[t].game);
+            free(hub->tables[t].order);
+        }
+        free(hub->retired);
+        free(hub->tables);
+        free(hub->deck);
+        if (hub->packedDeck != NULL) {
+            unmap_packed_deck(hub->packedDeck, hub->deckSize);
+        }
+    }
     exit(code);
 }
 
 /*
- * SIGINT handler. Exits game with SIGINT_CAUGHT exit code.
+ * SIGINT handler. Exits hub with SIGINT_CAUGHT exit code.
  *
  * @param sig Signal id
  */
 void handle_sigint(int sig) {
-    exit_game(globalGame, SIGINT_CAUGHT);
+    exit_hub(globalHub, SIGINT_CAUGHT);
 }
 
 /*
- * Sets up a child player process and sets up pipes to its stdin/stdout.
- * After forking, the child process with exec the given path.
- * If exec fails, it will write to a checking pipe to indicate exec failed.
- * The parent process will check for this, and if anything is read,
- * PLAYER_START_FAIL will be returned. The player's associated pid,
- * and in/out streams will be setup by parent process if successful.
+ * Starts a child player process and sets up pipes to its stdin/stdout.
+ * The child is started with posix_spawnp, which wires the pipes and
+ * /dev/null (for its stderr) in before running the given path, and gives
+ * back the default SIGPIPE action the hub ignores. If the
+ * path can't be run, posix_spawnp reports it and PLAYER_START_FAIL is
+ * returned. The player's associated pid, and in/out streams will be
+ * setup if successful.
  *
  * @param game The game struct
  * @param numPlayers The number of players in the game
@@ -185,64 +570,116 @@ void handle_sigint(int sig) {
  * @return NORMAL on success, PLAYER_START_FAIL on failure to start properly
  */
 Result setup_child(Game* game, int numPlayers, int playerId, char* path) {
-    int toPipe[2], fromPipe[2], checkPipe[2];
-    pid_t pid;
+    int toPipe[2], fromPipe[2];
 
-    if (pipe(toPipe) == -1 || pipe(fromPipe) == -1 || pipe(checkPipe) == -1) {
+    if (pipe(toPipe) == -1) {
         return PLAYER_START_FAIL; // System call error while piping
     }
+    if (pipe(fromPipe) == -1) {
+        close(toPipe[READ_END]);
+        close(toPipe[WRITE_END]);
+        return PLAYER_START_FAIL;
+    }
+    // Every end is close on exec, so no other child inherits them. The
+    // child's ends are dup2'd onto its stdin/stdout, which stay open.
+    for (int i = 0; i < 2; i++) {
+        fcntl(toPipe[i], F_SETFD, FD_CLOEXEC);
+        fcntl(fromPipe[i], F_SETFD, FD_CLOEXEC);
+    }
 
-    if ((pid = fork()) == 0) { // Child process
-        int devNull = open("/dev/null", O_WRONLY);
-        dup2(toPipe[READ_END], STDIN_FILENO);
-        dup2(fromPipe[WRITE_END], STDOUT_FILENO);
-        dup2(devNull, STDERR_FILENO); // Hide child process' stderr.
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, toPipe[READ_END],
+            STDIN_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, fromPipe[WRITE_END],
+            STDOUT_FILENO);
+    // Hide child process' stderr.
+    posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null",
+            O_WRONLY, 0);
+
+    posix_spawnattr_t attributes;
+    sigset_t defaults;
+    posix_spawnattr_init(&attributes);
+    sigemptyset(&defaults);
+    sigaddset(&defaults, SIGPIPE);
+    posix_spawnattr_setsigdefault(&attributes, &defaults);
+    posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETSIGDEF);
+
+    char id[3], playerCount[3]; // Strings to hold two numbers and \0
+    sprintf(id, "%d", playerId); // Convert playerId to string
+    sprintf(playerCount, "%d", numPlayers); // Convert numPlayers to str
+    char* args[] = {path, playerCount, id, NULL};
 
-        close(toPipe[WRITE_END]); // Close opposite sides of the pipes
+    pid_t pid;
+    int error = posix_spawnp(&pid, path, &actions, &attributes, args,
+            environ);
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attributes);
+    close(toPipe[READ_END]); // close child's sides of the pipes
+    close(fromPipe[WRITE_END]);
+    if (error != 0) {
+        close(toPipe[WRITE_END]);
         close(fromPipe[READ_END]);
-        close(checkPipe[READ_END]);
-        fcntl(checkPipe[WRITE_END], F_SETFD, FD_CLOEXEC);
-
-        char id[3], playerCount[3]; // Strings to hold two numbers and \0
-        sprintf(id, "%d", playerId); // Convert playerId to string
-        sprintf(playerCount, "%d", numPlayers); // Convert numPlayers to str
+        return PLAYER_START_FAIL; // path couldn't be run
+    }
 
-        execlp(path, path, playerCount, id, NULL);
-        write(checkPipe[WRITE_END], "!", 1); // Write arbritrary char to check
-    } else if (pid > 0) { // Parent process
-        game->players[playerId].pid = pid;
-        game->players[playerId].in = fdopen(toPipe[WRITE_END], "w");
-        game->players[playerId].out = fdopen(fromPipe[READ_END], "r");
+    game->players[playerId].pid = pid;
+    game->players[playerId].in = fdopen(toPipe[WRITE_END], "w");
+    game->players[playerId].out = fdopen(fromPipe[READ_END], "r");
+    game->players[playerId].received = malloc(BUFFER_SIZE);
 
-        fcntl(toPipe[WRITE_END], F_SETFD, FD_CLOEXEC);
-        fcntl(fromPipe[READ_END], F_SETFD, FD_CLOEXEC);
-        close(toPipe[READ_END]); // close opposite sides of the pipes
-        close(fromPipe[WRITE_END]);
-        close(checkPipe[WRITE_END]);
+    // The hub never blocks on a player, see send_to_player and
+    // read_player_line
+    fcntl(toPipe[WRITE_END], F_SETFL, O_NONBLOCK);
+    fcntl(fromPipe[READ_END], F_SETFL, O_NONBLOCK);
 
-        // Try to read from the checkpipe. This will only receive any data
-        // if exec failed
-        char test = 0;
-        if (read(checkPipe[READ_END], &test, 1) != 0) {
-            return PLAYER_START_FAIL; // exec failed
-        }
+    return NORMAL;
+}
 
-        return NORMAL;
+/*
+ * Loads a player plugin with dlopen. The plugin must export choose_move and
+ * set_move_callback, as players built with player.h and move.c do.
+ *
+ * @param game The game struct
+ * @param numPlayers The number of players in the game
+ * @param playerId Identifier (0-25) of current player
+ * @param path Path of the plugin's shared object
+ * @return NORMAL on success, PLAYER_START_FAIL if it can't be loaded
+ */
+Result load_plugin(Game* game, int numPlayers, int playerId, char* path) {
+    PlayerPlugin impl;
+    if (!open_player_plugin(path, &impl)) {
+        return PLAYER_START_FAIL;
     }
-    return PLAYER_START_FAIL; // fork failed
+
+    Plugin* plugin = malloc(sizeof(Plugin));
+    plugin->impl = impl;
+    plugin->view = setup_game(numPlayers);
+    plugin->view->myId = playerId;
+    game->players[playerId].plugin = plugin;
+    return NORMAL;
 }
 
 /*
- * Starts child player processes.
+ * Starts child player processes, or loads player plugins for paths
+ * ending in PLUGIN_SUFFIX.
  *
  * @param game The game struct
  * @param numPlayers The number of players in the game
- * @param paths Array of paths to player executables
+ * @param paths Array of paths to player executables or plugins
  * @return NORMAL on success, PLAYER_START_FAIL if any players failed to start
  */
 Result setup_children(Game* game, int numPlayers, char** paths) {
     for (int playerId = 0; playerId < numPlayers; playerId++) {
-        Result r = setup_child(game, numPlayers, playerId, paths[playerId]);
+        char* path = paths[playerId];
+        int length = strlen(path), suffixLength = strlen(PLUGIN_SUFFIX);
+        Result r;
+        if (length > suffixLength && strcmp(path + length - suffixLength,
+                PLUGIN_SUFFIX) == 0) {
+            r = load_plugin(game, numPlayers, playerId, path);
+        } else {
+            r = setup_child(game, numPlayers, playerId, path);
+        }
 
         if (r != NORMAL) {
             return r;
@@ -253,71 +690,56 @@ Result setup_children(Game* game, int numPlayers, char** paths) {
 }
 
 /*
- * Loads a deckfile into game struct.
- * Each line of deckfile is formatted as D:V:P,B,Y,R, where D is the
- * discount colour, V is the value, and P, B, Y, R are the prices in tokens for
- * Purple, Brown, Yellow, Red respectively.
- * Each line is seperated by a newline and the last line can either
- * have a newline or just EOF.
+ * Loads a deckfile into the hub, to be shared by every game.
+ * See read_deck_cards for the deckfile format. Binary decks written by
+ * deckc are mapped into memory and used as they are instead.
  * Deck is ordered in same way as deckfile, so first line of deckfile
  * will be the top of the deck.
-
  *
- * @param game The game struct
+ * @param hub The hub
  * @param filename Path to deckfile
  * @return Result of deckfile load.
  *         NORMAL on success, DECKFILE_UNREADABLE if filename can't be opened,
  *         DECKFILE_INCORRECT if file incorrectly formatted.
  *
  */
-Result load_deckfile(Game* game, char* filename) {
-    FILE* deckfile = fopen(filename, "r");
-    if (deckfile == NULL) {
+Result load_deckfile(Hub* hub, char* filename) {
+    int numCards = is_packed_deck_path(filename)
+            ? map_packed_deck(filename, &hub->packedDeck)
+            : read_deck_cards(filename, &hub->deck);
+    if (numCards == DECK_UNREADABLE) {
         return DECKFILE_UNREADABLE;
+    } else if (numCards == DECK_INVALID) {
+        return DECKFILE_INCORRECT;
     }
 
-    char lineBuffer[BUFFER_SIZE];
-    while (get_input(lineBuffer, BUFFER_SIZE, deckfile)) {
-
-        // Handle deckfile ending in newline
-        if (strlen(lineBuffer) == 0) {
-            // If deckfile ends in newline, then EOF must be next
-            if (fgetc(deckfile) == EOF) {
-                break;
-            }
-            return DECKFILE_INCORRECT;
-        }
-
-        Card card;
-        if (!create_card(lineBuffer, &card)
-                || has_any_whitespace(lineBuffer)) {
-            return DECKFILE_INCORRECT;
-        }
-
-        DeckCard* newCard = malloc(sizeof(DeckCard));
-        newCard->card = card;
-        newCard->next = NULL;
-
-        if (game->topOfDeck == NULL) {
-            // If deck is empty, add it top
-            game->topOfDeck = newCard;
-        } else {
-            // Otherwise, traverse to bottom of deck, and add it
-            DeckCard* cur = game->topOfDeck;
-            while (cur->next != NULL) {
-                cur = cur->next;
-            }
-            cur->next = newCard;
-        }
-
-    }
+    hub->deckSize = numCards;
+    return NORMAL;
+}
 
-    fclose(deckfile);
+/*
+ * Sets up the tables the hub will run games at, and the epoll instance
+ * their players are watched with. No games are started yet.
+ *
+ * @param hub The hub
+ * @param numTables Number of tables to run games at
+ */
+void setup_tables(Hub* hub, int numTables) {
+    hub->numTables = numTables;
+    hub->tables = calloc(numTables, sizeof(Table));
+    hub->epollFd = epoll_create1(EPOLL_CLOEXEC);
+}
 
-    if (game->topOfDeck == NULL) {
-        return DECKFILE_INCORRECT;
+/*
+ * Raises the limit on open files as far as allowed. Each player process
+ * takes two pipes, and the hub may be running many games.
+ */
+void raise_file_limit(void) {
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
     }
-    return NORMAL;
 }
 
 /*
@@ -326,15 +748,23 @@ Result load_deckfile(Game* game, char* filename) {
  *
  * Does nothing if board is already full or deck is empty.
  *
- * @param game The game struct
+ * @param table The game to take a card in
  */
-void take_card_from_deck(Game* game) {
+void take_card_from_deck(Table* table) {
+    Game* game = table->game;
+
     // Do nothing if board full, or deck empty
-    if (game->cardsFacedUp == MAX_CARDS_ON_BOARD || game->topOfDeck == NULL) {
+    if (game->cardsFacedUp == MAX_CARDS_ON_BOARD || table->cardsLeft == 0) {
         return;
     }
 
-    Card card = game->topOfDeck->card;
+    // Take card off deck. The deck itself is shared, so is left alone.
+    int index = (table->order != NULL)
+            ? table->order[table->nextCard] : table->nextCard;
+    Card card = (table->packedDeck != NULL)
+            ? unpack_card(&table->packedDeck[index]) : table->deck[index];
+    table->nextCard = (table->nextCard + 1) % table->deckSize;
+    table->cardsLeft--;
 
     add_card_to_board(game, card);
 
@@ -343,16 +773,12 @@ void take_card_from_deck(Game* game) {
             card.price[PURPLE], card.price[BROWN],
             card.price[YELLOW], card.price[RED]);
 
-    printf("New card = Bonus %c, worth %d, costs %d,%d,%d,%d\n",
+    print_game_line(table, stdout,
+            "New card = Bonus %c, worth %d, costs %d,%d,%d,%d\n",
             get_card_char(card.discount), card.value,
             card.price[PURPLE], card.price[BROWN],
             card.price[YELLOW], card.price[RED]);
     fflush(stdout);
-
-    // Take card off deck and free memory associated with it
-    DeckCard* oldTop = game->topOfDeck;
-    game->topOfDeck = oldTop->next;
-    free(oldTop);
 }
 
 /*
@@ -361,18 +787,19 @@ void take_card_from_deck(Game* game) {
  * Tells players how many tokens are in the piles and the details of cards
  * now on market.
  *
- * @param game The game struct
+ * @param table The game to start
  * @param initialTokens The initial number of tokens on board piles
  * @param maxPoints The number of points a player needs to win
  */
-void start_new_game(Game* game, int initialTokens, int maxPoints) {
+void start_new_game(Table* table, int initialTokens, int maxPoints) {
+    Game* game = table->game;
     game->maxPoints = maxPoints;
 
     set_initial_game_tokens(game, initialTokens);
     send_message_all(game, "tokens%d\n", initialTokens);
 
     for (int i = 0; i < MAX_CARDS_ON_BOARD; i++) {
-        take_card_from_deck(globalGame);
+        take_card_from_deck(table);
     }
 }
 
@@ -381,14 +808,16 @@ void start_new_game(Game* game, int initialTokens, int maxPoints) {
  * Updates internal game state, prints to stdout
  * and tells players who took wild.
  *
- * @param game The game struct
+ * @param table The game the player is in
  * @param playerId Player asking to take wild
  */
-void handle_wild_take(Game* game, int playerId) {
+void handle_wild_take(Table* table, int playerId) {
+    Game* game = table->game;
     player_took_wild(game, playerId);
     send_message_all(game, "wild%c\n", player_int_to_char(playerId));
 
-    printf("Player %c took a wild\n", player_int_to_char(playerId));
+    print_game_line(table, stdout, "Player %c took a wild\n",
+            player_int_to_char(playerId));
 }
 
 /*
@@ -398,17 +827,20 @@ void handle_wild_take(Game* game, int playerId) {
  *
  * Doesn't check if token take is a valid move.
 
- * @param game The game struct
+ * @param table The game the player is in
  * @param playerId Player asking to take tokens
  * @param tokens The tokens the player is taking
  */
-void handle_token_take(Game* game, int playerId, int tokens[NUM_COLOURS]) {
+void handle_token_take(Table* table, int playerId,
+        int tokens[NUM_COLOURS]) {
+    Game* game = table->game;
     player_took_tokens(game, playerId, tokens);
     send_message_all(game, "took%c:%d,%d,%d,%d\n",
             player_int_to_char(playerId),
             tokens[PURPLE], tokens[BROWN], tokens[YELLOW], tokens[RED]);
 
-    printf("Player %c drew %d,%d,%d,%d\n", player_int_to_char(playerId),
+    print_game_line(table, stdout, "Player %c drew %d,%d,%d,%d\n",
+            player_int_to_char(playerId),
             tokens[PURPLE], tokens[BROWN], tokens[YELLOW], tokens[RED]);
 }
 
@@ -419,192 +851,612 @@ void handle_token_take(Game* game, int playerId, int tokens[NUM_COLOURS]) {
  *
  * Doesn't check if purchase is a valid move.
 
- * @param game The game struct
+ * @param table The game the player is in
  * @param playerId Player asking to purchase card
  * @param cardId Card faced up to be purchased
  * @param tokens The tokens the player is using to purchase card
  */
-void handle_card_purchase(Game* game, int playerId, int cardId,
+void handle_card_purchase(Table* table, int playerId, int cardId,
         int tokens[TOKEN_SLOTS]) {
+    Game* game = table->game;
 
     send_message_all(game, "purchased%c:%d:%d,%d,%d,%d,%d\n",
             player_int_to_char(playerId), cardId,
             tokens[PURPLE], tokens[BROWN], tokens[YELLOW], tokens[RED],
             tokens[WILD]);
 
-    printf("Player %c purchased %d using %d,%d,%d,%d,%d\n",
+    print_game_line(table, stdout,
+            "Player %c purchased %d using %d,%d,%d,%d,%d\n",
             player_int_to_char(playerId), cardId,
             tokens[PURPLE], tokens[BROWN], tokens[YELLOW], tokens[RED],
             tokens[WILD]);
 
     player_purchased_card(game, playerId, cardId, tokens);
-    take_card_from_deck(game);
+    take_card_from_deck(table);
 }
 
 /*
- * Handles input from a player process.
- * Valid message must either start with "wild", "take" or "purchase".
+ * Parses a move message from a player process.
+ * Valid message must either be "wild", or start with "take" or "purchase".
+ * Only checks the message is well formed, not that the move is legal.
  *
- * @param game The game struct
- * @param playerId The player input is from
  * @param input Input string received from player process
- * @return true if input was valid and processed, false otherwise
+ * @param move Destination for the move parsed
+ * @return true if input was a well formed move, false otherwise
  */
-bool handle_input(Game* game, int playerId, char* input) {
+bool parse_move(char* input, PlayerMove* move) {
     if (strcmp(input, MSG_WILD_TAKE) == 0) {
-        handle_wild_take(game, playerId);
+        move->type = MOVE_WILD;
         return true;
     } else if (starts_with(input, MSG_TOKEN_TAKE)) {
         char* info = input + strlen(MSG_TOKEN_TAKE); // Get data from msg
-        int tokens[NUM_COLOURS];
+        move->type = MOVE_TAKE;
 
-        int result = sscanf(info, "%d,%d,%d,%d", &tokens[PURPLE],
-                &tokens[BROWN], &tokens[YELLOW], &tokens[RED]);
-
-        // Check if invalid input, or dodgy token take
-        if (has_any_whitespace(info) || result != 4
-                || !is_valid_token_take(game, tokens)) {
-            return false;
-        }
-
-        handle_token_take(game, playerId, tokens);
-        return true;
+        int result = sscanf(info, "%d,%d,%d,%d", &move->tokens[PURPLE],
+                &move->tokens[BROWN], &move->tokens[YELLOW],
+                &move->tokens[RED]);
+        return !has_any_whitespace(info) && result == 4;
     } else if (starts_with(input, MSG_CARD_PURCHASE)) {
         char* info = input + strlen(MSG_CARD_PURCHASE); // Get data from msg
-        int cardId, tokens[TOKEN_SLOTS];
+        move->type = MOVE_PURCHASE;
 
         int result = sscanf(info, "%d:%d,%d,%d,%d,%d",
-                &cardId, &tokens[PURPLE], &tokens[BROWN], &tokens[YELLOW],
-                &tokens[RED], &tokens[WILD]);
-
-        // Check if invalid input, or wrong tokens
-        if (has_any_whitespace(info) || result != 6
-                || cardId < 0 || cardId >= game->cardsFacedUp
-                || !can_tokens_buy_card(game, playerId, cardId, tokens)) {
-            return false;
-        }
-
-        handle_card_purchase(game, playerId, cardId, tokens);
-        return true;
+                &move->cardId, &move->tokens[PURPLE], &move->tokens[BROWN],
+                &move->tokens[YELLOW], &move->tokens[RED],
+                &move->tokens[WILD]);
+        return !has_any_whitespace(info) && result == 6;
     }
     // Input was invalid
     return false;
 }
 
 /*
- * Sends a "dowhat" message to a player with given id.
+ * Checks a player's move is legal, and if so makes it.
+ *
+ * @param table The game the player is in
+ * @param playerId The player making the move
+ * @param move Move the player chose
+ * @return true if move was legal and made, false otherwise
+ */
+bool apply_move(Table* table, int playerId, PlayerMove* move) {
+    // Check for dodgy token take, or wrong tokens
+    if (!is_legal_move(table->game, playerId, move)) {
+        return false;
+    }
+
+    if (move->type == MOVE_WILD) {
+        handle_wild_take(table, playerId);
+    } else if (move->type == MOVE_TAKE) {
+        handle_token_take(table, playerId, move->tokens);
+    } else {
+        handle_card_purchase(table, playerId, move->cardId, move->tokens);
+    }
+    return true;
+}
+
+/*
+ * Sends a "dowhat" message to a player with given id. Whatever doesn't fit
+ * in their pipe is written by run_games while waiting for a reply.
  *
  * @param game The game struct
  * @param playerId Player to send message to
  */
 void send_dowhat(Game* game, int playerId) {
-    fprintf(game->players[playerId].in, "dowhat\n");
-    fflush(game->players[playerId].in);
+    send_to_player(game, playerId, "dowhat\n", strlen("dowhat\n"));
 }
 
 /*
- * Runs the main game loop.
- * Starts from player 0, and goes around to each player, sending them
- * a "dowhat" message to ask for their move. If they send an invalid
- * message, ask them again. If still invalid, end game with protocol error.
- * If a player reaches the max number of points needed, game will end after
- * all players have had their turn in the round. If the game runs out of cards
- * then the game will end immediately when it occurs.
- * If a player disconnects, game will also end when trying to get their input.
+ * Takes the first line out of the bytes received from a player, in the
+ * same way get_input would read it: up to and not including a newline,
+ * or BUFFER_SIZE - 1 bytes if there is no newline in that many.
  *
- * @param game The game struct
- * @return NORMAL on normal end of game,
- *         BAD_PROTOCOL if player sent invalid message twice in a row,
- *         PLAYER_DISCONNECT if a player disconnected
+ * @param player Player to take line from
+ * @param line Destination for line, of size BUFFER_SIZE
+ * @param atEnd Whether the player's stdout has closed, in which case
+ *        whatever is left is taken as the last line
+ * @return true if a line was taken, false if more input is needed
  */
-Result run_game_loop(Game* game) {
-    bool maxPointsReached = false;
+bool take_line(Player* player, char* line, bool atEnd) {
+    char* newline = memchr(player->received, '\n', player->receivedSize);
+    int length, used;
+    if (newline != NULL) {
+        length = newline - player->received;
+        used = length + 1;
+    } else if (player->receivedSize == BUFFER_SIZE - 1
+            || (atEnd && player->receivedSize > 0)) {
+        length = used = player->receivedSize;
+    } else {
+        return false;
+    }
 
-    while (true) {
-        if (maxPointsReached) { // check if game over first.
-            return NORMAL;
+    memcpy(line, player->received, length);
+    line[length] = '\0';
+    player->receivedSize -= used;
+    memmove(player->received, player->received + used,
+            player->receivedSize);
+    return true;
+}
+
+/*
+ * Reads whatever a player has written to their stdout so far, without
+ * blocking, and takes the first line out of it.
+ *
+ * @param player Player to read from
+ * @param line Destination for line read, of size BUFFER_SIZE
+ * @param disconnected Set to true if the player's stdout has closed with
+ *        no line left in it
+ * @return true if a line was read, false if there isn't a whole line yet
+ */
+bool read_player_line(Player* player, char* line, bool* disconnected) {
+    int fd = fileno(player->out);
+
+    while (!take_line(player, line, false)) {
+        ssize_t numRead = read(fd, player->received + player->receivedSize,
+                BUFFER_SIZE - 1 - player->receivedSize);
+        if (numRead > 0) {
+            player->receivedSize += numRead;
+        } else if (numRead == -1 && errno == EAGAIN) {
+            return false;
+        } else if (numRead == 0 || errno != EINTR) {
+            // EOF reached, they have disconnected
+            *disconnected = !take_line(player, line, true);
+            return !*disconnected;
         }
+    }
 
-        for (int curPlayer = 0; curPlayer < game->numPlayers; curPlayer++) {
-            // Player gets two attempts to give a valid move.
-            bool alreadyAttempted = false;
-            while (true) {
-                send_dowhat(game, curPlayer); // Ask player for their move
+    return true;
+}
 
-                char buffer[BUFFER_SIZE];
-                if (!get_input(buffer, BUFFER_SIZE,
-                        game->players[curPlayer].out)) {
-                    // EOF reached, they have disconnected
-                    return PLAYER_DISCONNECT;
-                }
+/*
+ * Finishes the current player's turn with the move they chose.
+ * If the move is invalid, they will be asked again. If still invalid, the
+ * game ends with protocol error. If a player reaches the max number of
+ * points needed, the game will end after all players have had their turn
+ * in the round. If the game runs out of cards then the game will end
+ * immediately when it occurs.
+ *
+ * @param table The game being played
+ * @param move Move the current player chose
+ */
+void take_turn(Table* table, PlayerMove* move) {
+    Game* game = table->game;
+
+    // Check if move is valid
+    if (!apply_move(table, table->curPlayer, move)) {
+        // If they have given an invalid response twice,
+        // it is a protocol error.
+        if (table->attempted) {
+            end_game(table, BAD_PROTOCOL);
+        }
+        table->attempted = true;
+        return;
+    }
+    table->attempted = false;
 
-                // Check if input is valid
-                if (!handle_input(game, curPlayer, buffer)) {
-                    // If they have given an invalid response twice,
-                    // it is a protocol error.
-                    if (alreadyAttempted) {
-                        return BAD_PROTOCOL;
-                    }
-                    alreadyAttempted = true;
-                } else {
-                    break; // valid response, quit loop
-                }
+    // Check if max points been reached
+    if (is_game_over(game)) {
+        table->lastRound = true;
+    }
+
+    // If no cards left, end game immediately
+    if (game->cardsFacedUp == 0) {
+        end_game(table, NORMAL);
+        return;
+    }
+
+    table->curPlayer = (table->curPlayer + 1) % game->numPlayers;
+    if (table->curPlayer == 0 && table->lastRound) {
+        end_game(table, NORMAL);
+    }
+}
+
+/*
+ * Gets the epoll event data identifying a player's stdout. Their stdin is
+ * identified by one more than this.
+ *
+ * @param tableIndex Index of the game the player is in
+ * @param playerId The player
+ * @return Event data for the player's stdout
+ */
+uint32_t get_event_data(int tableIndex, int playerId) {
+    return (tableIndex * MAX_PLAYERS + playerId) * 2;
+}
+
+/*
+ * Makes a player's pipes report to the hub's epoll instance.
+ * Their stdout is watched one shot at a time, and only re-armed by
+ * advance_game when the game is waiting on their reply, so players who
+ * have exited out of turn don't keep waking the hub. Their stdin is
+ * watched edge triggered, which only fires once a full pipe has room
+ * again, so pending messages can be written.
+ *
+ * @param hub The hub
+ * @param tableIndex Index of the game the player is in
+ * @param playerId Player to watch
+ */
+void watch_player(Hub* hub, int tableIndex, int playerId) {
+    Player* player = &hub->tables[tableIndex].game->players[playerId];
+    uint32_t data = get_event_data(tableIndex, playerId);
+
+    struct epoll_event event = {.events = EPOLLIN | EPOLLONESHOT,
+            .data.u32 = data};
+    epoll_ctl(hub->epollFd, EPOLL_CTL_ADD, fileno(player->out), &event);
+    event = (struct epoll_event) {.events = EPOLLOUT | EPOLLET,
+            .data.u32 = data + 1};
+    epoll_ctl(hub->epollFd, EPOLL_CTL_ADD, fileno(player->in), &event);
+}
+
+/*
+ * Moves the players of a game that ended normally into a new game, instead
+ * of starting new player processes. Player processes are sent
+ * "newgame pcount myid" so they start tracking the new game, and plugin
+ * players get a new view of the game.
+ *
+ * @param previous The game that ended. Its players are moved out.
+ * @param game The new game
+ */
+void reuse_players(Game* previous, Game* game) {
+    for (int i = 0; i < game->numPlayers; i++) {
+        Player* from = &previous->players[i];
+        Player* to = &game->players[i];
+
+        to->in = from->in;
+        to->out = from->out;
+        to->pid = from->pid;
+        to->plugin = from->plugin;
+        to->pending = from->pending;
+        to->pendingSize = from->pendingSize;
+        to->pendingCapacity = from->pendingCapacity;
+        to->received = from->received;
+        to->receivedSize = from->receivedSize;
+        from->in = from->out = NULL;
+        from->pid = 0;
+        from->plugin = NULL;
+        from->pending = from->received = NULL;
+
+        if (to->plugin != NULL) {
+            free_game(to->plugin->view);
+            to->plugin->view = setup_game(game->numPlayers);
+            to->plugin->view->myId = i;
+        } else {
+            char message[BUFFER_SIZE];
+            int length = sprintf(message, "newgame %d %d\n",
+                    game->numPlayers, i);
+            send_to_player(game, i, message, length);
+        }
+    }
+}
+
+/*
+ * Starts the next game waiting to run at a table.
+ * If the hub was given a seed, game i (from 1) deals the shared deck in
+ * its own order, shuffled by shuffle_deck_order as game i - 1. Otherwise
+ * game i deals it starting (i - 1) * deckSize / numGames cards in,
+ * wrapping around to the top, so each game gets a different deal. With
+ * one game and no seed, the deck is dealt from the top.
+ *
+ * @param hub The hub
+ * @param tableIndex Index of the table to start the game at
+ * @param reuse Whether to keep the players of the game that just ended at
+ *        the table, instead of starting new ones
+ * @return NORMAL on success, PLAYER_START_FAIL if any players failed to start
+ */
+Result start_game(Hub* hub, int tableIndex, bool reuse) {
+    Table* table = &hub->tables[tableIndex];
+    Game* previous = reuse ? table->game : NULL;
+    int id = ++hub->numStarted;
+    int* order = table->order;
+
+    *table = (Table) {.game = setup_game(hub->numPlayers), .id = id,
+            .deck = hub->deck, .packedDeck = hub->packedDeck,
+            .deckSize = hub->deckSize, .order = order,
+            .nextCard = (long long) (id - 1) * hub->deckSize / hub->numGames,
+            .cardsLeft = hub->deckSize, .deadline = -1};
+    if (hub->shuffled) {
+        if (order == NULL) {
+            table->order = malloc(sizeof(int) * hub->deckSize);
+        }
+        shuffle_deck_order(table->order, hub->deckSize, hub->seed, id - 1);
+        table->nextCard = 0;
+    }
+
+    if (previous != NULL) {
+        reuse_players(previous, table->game);
+        free_game(previous);
+    } else {
+        Result r = setup_children(table->game, hub->numPlayers, hub->paths);
+        for (int i = 0; i < hub->numPlayers; i++) {
+            if (table->game->players[i].pid > 0) {
+                watch_player(hub, tableIndex, i);
             }
+        }
+        if (r != NORMAL) {
+            return r;
+        }
+    }
 
-            // Check if max points been reached
-            if (is_game_over(game)) {
-                maxPointsReached = true;
+    // send initial tokens and newcard messages
+    start_new_game(table, hub->initialTokens, hub->maxPoints);
+    return NORMAL;
+}
+
+/*
+ * Deals with the players of a game that has just ended. If there are
+ * games still waiting to run, the next one starts at the same table.
+ * It keeps the players if the game ended normally. Otherwise the players
+ * are sent "eog", and (if the game ended early) kept to be reaped once the
+ * hub is done.
+ *
+ * @param hub The hub
+ * @param tableIndex Index of the table the game ended at
+ * @return true if another game was started at the table
+ */
+bool finish_game(Hub* hub, int tableIndex) {
+    Table* table = &hub->tables[tableIndex];
+
+    if (table->result != NORMAL && (hub->firstFailure == 0
+            || table->id < hub->firstFailure)) {
+        hub->firstFailure = table->id;
+        hub->failure = table->result;
+    }
+
+    bool reuse = table->result == NORMAL;
+    if (!reuse || hub->numStarted == hub->numGames) {
+        send_message_all(table->game, "eog\n");
+    }
+    if (hub->numStarted == hub->numGames) {
+        return false;
+    }
+
+    if (!reuse) {
+        // Stop watching the players, their pipes will be closed when the
+        // hub is done with them
+        for (int i = 0; i < hub->numPlayers; i++) {
+            Player* player = &table->game->players[i];
+            if (player->pid > 0) {
+                epoll_ctl(hub->epollFd, EPOLL_CTL_DEL, fileno(player->out),
+                        NULL);
+                epoll_ctl(hub->epollFd, EPOLL_CTL_DEL, fileno(player->in),
+                        NULL);
             }
+        }
+        hub->retired = realloc(hub->retired,
+                (hub->numRetired + 1) * sizeof(Table));
+        hub->retired[hub->numRetired++] = *table;
+    }
 
-            // If no cards left, end game immediately
-            if (game->cardsFacedUp == 0) {
-                return NORMAL;
+    Result r = start_game(hub, tableIndex, reuse);
+    if (r != NORMAL) {
+        exit_hub(hub, r);
+    }
+    return true;
+}
+
+/*
+ * Moves a game along until it is waiting on a player process to reply,
+ * or is over. Players are asked for their move with a "dowhat" message,
+ * or by calling a plugin player's choose_move directly. A player process
+ * that has disconnected ends the game. Once the game is over, the next
+ * game waiting to run at the table is started and moved along too.
+ *
+ * @param hub The hub
+ * @param tableIndex Index of the table to move along
+ */
+void advance_game(Hub* hub, int tableIndex) {
+    Table* table = &hub->tables[tableIndex];
+
+    while (true) {
+        if (table->finished) {
+            if (!finish_game(hub, tableIndex)) {
+                return;
+            }
+            continue;
+        }
+
+        Player* player = &table->game->players[table->curPlayer];
+        PlayerMove move = {.type = MOVE_NONE};
+
+        if (player->plugin != NULL) {
+            Plugin* plugin = player->plugin;
+            ask_player_plugin(&plugin->impl, table->game, plugin->view,
+                    &move);
+            take_turn(table, &move);
+            continue;
+        }
+
+        if (!table->waiting) {
+            send_dowhat(table->game, table->curPlayer); // Ask for move
+            table->waiting = true;
+            table->deadline = (hub->moveTimeout < 0)
+                    ? -1 : get_clock_ms() + hub->moveTimeout;
+        }
+
+        char buffer[BUFFER_SIZE];
+        bool disconnected = false;
+        if (!read_player_line(player, buffer, &disconnected)) {
+            if (disconnected) {
+                end_game(table, PLAYER_DISCONNECT);
+                continue;
             }
+            // Wait for the rest of their reply
+            struct epoll_event event = {.events = EPOLLIN | EPOLLONESHOT,
+                    .data.u32 = get_event_data(tableIndex,
+                    table->curPlayer)};
+            epoll_ctl(hub->epollFd, EPOLL_CTL_MOD, fileno(player->out),
+                    &event);
+            return;
+        }
+        table->waiting = false;
+
+        if (!parse_move(buffer, &move)) {
+            move.type = MOVE_NONE;
         }
+        take_turn(table, &move);
     }
-    // Won't ever actually reach here as loop only breaks by returning early
-    return NORMAL;
+}
+
+/*
+ * Ends every game whose current player has missed their deadline, killing
+ * the player (a player this far behind won't read "eog" either). The next
+ * game waiting to run at the table is started in its place.
+ *
+ * @param hub The hub
+ * @return Time (ms) until the next deadline, or -1 if there is none
+ */
+int check_deadlines(Hub* hub) {
+    long long now = get_clock_ms();
+    int timeout = -1;
+
+    for (int t = 0; t < hub->numTables; t++) {
+        Table* table = &hub->tables[t];
+        if (!table->finished && table->deadline >= 0
+                && now >= table->deadline) {
+            kill(table->game->players[table->curPlayer].pid, SIGKILL);
+            end_game(table, PLAYER_TIMEOUT);
+            advance_game(hub, t);
+        }
+        if (!table->finished && table->deadline >= 0 && (timeout < 0
+                || table->deadline - now < timeout)) {
+            timeout = (table->deadline > now) ? table->deadline - now : 0;
+        }
+    }
+
+    return timeout;
+}
+
+/*
+ * Runs every game until they are all over, from one event loop.
+ * Each table waits on its current player's stdout. While waiting, messages
+ * still pending for any player are written as their pipes make room, so
+ * a player that stops reading holds up no one but itself.
+ * If a player process takes longer than moveTimeout ms to reply to a
+ * "dowhat", its game ends with a timeout. Plugin players are called
+ * directly, so can't be timed out.
+ *
+ * @param hub The hub, with every game started
+ * @return NORMAL if every game ended normally, otherwise how the first
+ *         game (by number) that didn't ended
+ */
+Result run_games(Hub* hub) {
+    for (int t = 0; t < hub->numTables; t++) {
+        advance_game(hub, t);
+    }
+
+    while (true) {
+        int timeout = (hub->moveTimeout < 0) ? -1 : check_deadlines(hub);
+        bool anyRunning = false;
+        for (int t = 0; t < hub->numTables && !anyRunning; t++) {
+            anyRunning = !hub->tables[t].finished;
+        }
+        if (!anyRunning) {
+            break;
+        }
+
+        struct epoll_event events[EVENT_BATCH];
+        int numEvents = epoll_wait(hub->epollFd, events, EVENT_BATCH,
+                timeout);
+        for (int i = 0; i < numEvents; i++) {
+            int tableIndex = events[i].data.u32 / 2 / MAX_PLAYERS;
+            int playerId = events[i].data.u32 / 2 % MAX_PLAYERS;
+            Table* table = &hub->tables[tableIndex];
+
+            if (events[i].data.u32 % 2 == 1) {
+                send_to_player(table->game, playerId, NULL, 0);
+            } else if (!table->finished && table->waiting
+                    && table->curPlayer == playerId) {
+                advance_game(hub, tableIndex);
+            }
+        }
+    }
+    close(hub->epollFd);
+
+    return (hub->firstFailure == 0) ? NORMAL : hub->failure;
 }
 
 int main(int argc, char** argv) {
+    int moveTimeout = -1, numGames = 1, numTables = 0, seed = 0;
+    bool shuffled = false;
+
+    // Parse options, which come before other arguments
+    int arg = 1;
+    while (arg + 1 < argc && starts_with(argv[arg], "--")) {
+        if (strcmp(argv[arg], "--move-timeout") == 0) {
+            if (!str_to_int(argv[arg + 1], &moveTimeout)
+                    || moveTimeout < 0) {
+                exit_hub(NULL, INVALID_ARGS);
+            }
+        } else if (strcmp(argv[arg], "--games") == 0) {
+            if (!str_to_int(argv[arg + 1], &numGames) || numGames < 1) {
+                exit_hub(NULL, INVALID_ARGS);
+            }
+        } else if (strcmp(argv[arg], "--parallel") == 0) {
+            if (!str_to_int(argv[arg + 1], &numTables) || numTables < 1) {
+                exit_hub(NULL, INVALID_ARGS);
+            }
+        } else if (strcmp(argv[arg], "--seed") == 0) {
+            if (!str_to_int(argv[arg + 1], &seed)) {
+                exit_hub(NULL, INVALID_ARGS);
+            }
+            shuffled = true;
+        } else {
+            exit_hub(NULL, WRONG_NUM_ARGS);
+        }
+        arg += 2;
+    }
+    argc -= arg - 1;
+    argv += arg - 1;
+
     // Parse command line arguments.
     if (argc < 6 || argc > MAX_PLAYERS + 4) {
-        exit_game(NULL, WRONG_NUM_ARGS);
+        exit_hub(NULL, WRONG_NUM_ARGS);
     }
 
     int initialTokens = 0, maxPoints = 0;
     if (!str_to_int(argv[1], &initialTokens)
             || !str_to_int(argv[2], &maxPoints)
             || initialTokens < 0 || maxPoints < 0) {
-        exit_game(NULL, INVALID_ARGS);
+        exit_hub(NULL, INVALID_ARGS);
     }
 
-    // Setup game struct. argc - 4 == number of players
-    Game* game = setup_game(argc - 4);
-    globalGame = game;
+    // argc - 4 == number of players
+    Hub hub = {.deck = NULL, .packedDeck = NULL, .shuffled = shuffled,
+            .seed = seed, .paths = argv + 4,
+            .numPlayers = argc - 4, .initialTokens = initialTokens,
+            .maxPoints = maxPoints, .moveTimeout = moveTimeout,
+            .numGames = numGames,
+            .numStarted = 0, .numTables = 0, .retired = NULL,
+            .numRetired = 0, .firstFailure = 0};
+    globalHub = &hub;
 
     // Load deckfile
-    Result deckfileStatus = load_deckfile(game, argv[3]);
+    Result deckfileStatus = load_deckfile(&hub, argv[3]);
     if (deckfileStatus != NORMAL) {
-        exit_game(game, deckfileStatus);
+        exit_hub(&hub, deckfileStatus);
     }
 
-    // Setup child processes
-    Result childStatus = setup_children(game, argc - 4, argv + 4);
-    if (childStatus != NORMAL) {
-        exit_game(game, childStatus);
-    }
-
-    // send initial tokens and newcard messages
-    start_new_game(game, initialTokens, maxPoints);
-
-    // Handle SIGINT. Ignore SIGPIPE, as detecting pipe closes by read fails
+    // Handle SIGINT. Ignore SIGPIPE, as detecting pipe closes by read fails.
+    // Both are set up before any player starts, as starting a game already
+    // writes to players that may have gone.
     struct sigaction sa = {.sa_handler = handle_sigint};
     sigaction(SIGINT, &sa, 0);
     signal(SIGPIPE, SIG_IGN);
 
-    Result finalResult = run_game_loop(game);
-    exit_game(game, finalResult);
+    // Start the first game at each table. By default every game runs at
+    // once, each at its own table.
+    if (numTables == 0 || numTables > numGames) {
+        numTables = numGames;
+    }
+    setup_tables(&hub, numTables);
+    raise_file_limit();
+    for (int t = 0; t < numTables; t++) {
+        Result childStatus = start_game(&hub, t, false);
+        if (childStatus != NORMAL) {
+            exit_hub(&hub, childStatus);
+        }
+    }
+
+    Result finalResult = run_games(&hub);
+    exit_hub(&hub, finalResult);
 
     return 0;
 }
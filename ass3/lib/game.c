@@ -66,15 +66,8 @@ void free_game(Game* game) {
         return;
     }
 
-    // For hub: Free DeckCard's if any
-    DeckCard* oldTop;
-    while (game->topOfDeck != NULL) {
-        oldTop = game->topOfDeck;
-        game->topOfDeck = game->topOfDeck->next;
-        free(oldTop);
-    }
-
-    // For hub: Close file streams to players' stdin/stdout
+    // For hub: Close file streams to players' stdin/stdout, and free any
+    // messages still pending or input not yet read as a line
     for (int playerId = 0; playerId < game->numPlayers; playerId++) {
         if (game->players[playerId].in != NULL) {
             fclose(game->players[playerId].in);
@@ -83,6 +76,9 @@ void free_game(Game* game) {
         if (game->players[playerId].out != NULL) {
             fclose(game->players[playerId].out);
         }
+
+        free(game->players[playerId].pending);
+        free(game->players[playerId].received);
     }
 
     // Free players array
@@ -101,7 +97,6 @@ void free_game(Game* game) {
 Game* setup_game(int numPlayers) {
     Game* game = malloc(sizeof(Game));
 
-    game->topOfDeck = NULL;
     game->cardsFacedUp = 0;
     game->numPlayers = numPlayers;
 
@@ -118,6 +113,13 @@ Game* setup_game(int numPlayers) {
         // File streams haven't been setup yet. Player processes don't need.
         game->players[i].in = NULL;
         game->players[i].out = NULL;
+        game->players[i].pid = 0;
+        game->players[i].plugin = NULL;
+        game->players[i].pending = NULL;
+        game->players[i].pendingSize = 0;
+        game->players[i].pendingCapacity = 0;
+        game->players[i].received = NULL;
+        game->players[i].receivedSize = 0;
     }
 
     return game;
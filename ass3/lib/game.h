@@ -23,6 +23,34 @@ typedef enum {
     INVALID_COLOUR
 } CardColour;
 
+/*
+ * Kind of move a player makes on their turn
+ */
+typedef enum {
+    MOVE_NONE,
+    MOVE_WILD,
+    MOVE_TAKE,
+    MOVE_PURCHASE
+} MoveType;
+
+/*
+ * A move chosen by a player.
+ * - type: The kind of move, MOVE_NONE if no move was chosen
+ * - cardId: Face up card being purchased (MOVE_PURCHASE only)
+ * - tokens: Tokens taken (MOVE_TAKE, colours only) or used to purchase
+ *   the card (MOVE_PURCHASE, including wilds)
+ */
+typedef struct {
+    MoveType type;
+    int cardId;
+    int tokens[TOKEN_SLOTS];
+} PlayerMove;
+
+/*
+ * Called with the move a player chose, and the data given along with it
+ */
+typedef void (*MoveCallback)(PlayerMove* move, void* data);
+
 /*
  * Holds information about a card
  * - discount: The discount colour associated with a card
@@ -35,16 +63,6 @@ typedef struct {
     int price[NUM_COLOURS];
 } Card;
 
-/*
- * Represents a card in the deck for the hub.
- * - card: Information about the card
- * - next: pointer to the next DeckCard in the deck.
- */
-typedef struct DeckCard {
-    Card card;
-    struct DeckCard* next;
-} DeckCard;
-
 /*
  * Stores information about a single player in a game.
  * - totalPoints: How many total points the player has from card purchases
@@ -54,6 +72,15 @@ typedef struct DeckCard {
  * - in: holds player's stdin, used by hub to send messages
  * - out: holds player's stdout, used by hub to read player moves
  * - pid: The process id of the player after fork
+ * - plugin: The player loaded into the hub with dlopen, or NULL if the
+ *   player is a process
+ * - pending: Messages not yet written to the player's stdin, because its
+ *   pipe was full
+ * - pendingSize: Number of bytes in pending
+ * - pendingCapacity: Number of bytes pending has room for
+ * - received: Bytes read from the player's stdout that don't yet make up
+ *   a whole line
+ * - receivedSize: Number of bytes in received
  */
 typedef struct {
     int totalPoints;
@@ -63,6 +90,12 @@ typedef struct {
     FILE* in;
     FILE* out;
     pid_t pid;
+    struct Plugin* plugin;
+    char* pending;
+    int pendingSize;
+    int pendingCapacity;
+    char* received;
+    int receivedSize;
 } Player;
 
 /*
@@ -75,8 +108,6 @@ typedef struct {
  * - players: Array of players in the game
  * Player process specific:
  * - myId: Holds the id of the current player
- * Hub specific:
- * - topOfDeck: Pointer to the top of the deck
  */
 typedef struct {
     int myId;
@@ -87,7 +118,6 @@ typedef struct {
     int cardsFacedUp;
 
     Card cards[MAX_CARDS_ON_BOARD];
-    DeckCard* topOfDeck;
     Player* players;
 } Game;
 
@@ -0,0 +1,600 @@
+#include "match.h"
+#include "util.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* Step between states of shuffle_deck_order's generator (splitmix64's) */
+#define SHUFFLE_STATE_STEP 0x9e3779b97f4a7c15ULL
+
+/*
+ * Loads a player implementation with dlopen. It must export choose_move
+ * and set_move_callback, as players built with player.h and move.c do.
+ * A path without a '/' is taken as relative to the current directory,
+ * rather than searched for on the library path as dlopen would.
+ *
+ * @param path Path of the player's shared object
+ * @param plugin Destination to store loaded player in
+ * @return true if loaded, false if it can't be loaded
+ */
+bool open_player_plugin(char* path, PlayerPlugin* plugin) {
+    char localPath[strlen(path) + sizeof("./")];
+    if (strchr(path, '/') == NULL) {
+        sprintf(localPath, "./%s", path);
+        path = localPath;
+    }
+
+    plugin->handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    if (plugin->handle == NULL) {
+        return false;
+    }
+
+    *(void**) &plugin->choose_move = dlsym(plugin->handle, "choose_move");
+    *(void**) &plugin->set_move_callback = dlsym(plugin->handle,
+            "set_move_callback");
+
+    if (plugin->choose_move == NULL || plugin->set_move_callback == NULL) {
+        dlclose(plugin->handle);
+        plugin->handle = NULL;
+        return false;
+    }
+    return true;
+}
+
+/*
+ * Unloads a player implementation loaded with open_player_plugin.
+ *
+ * @param plugin Player implementation to unload
+ */
+void close_player_plugin(PlayerPlugin* plugin) {
+    if (plugin->handle != NULL) {
+        dlclose(plugin->handle);
+        plugin->handle = NULL;
+    }
+}
+
+/*
+ * Stores the move a plugin chose. Passed to set_move_callback.
+ *
+ * @param move Move chosen by the plugin
+ * @param data PlayerMove to store move in
+ */
+void store_move(PlayerMove* move, void* data) {
+    *(PlayerMove*) data = *move;
+}
+
+/*
+ * Asks a plugin player for their move. The player's view is brought up to
+ * date with the board first, as a process player would have from the
+ * messages sent to it.
+ *
+ * @param plugin Player implementation to ask
+ * @param game The game being played
+ * @param view The player's view of the game, with myId set
+ * @param move Set to the move chosen, MOVE_NONE if the plugin chose none
+ */
+void ask_player_plugin(PlayerPlugin* plugin, Game* game, Game* view,
+        PlayerMove* move) {
+    view->maxPoints = game->maxPoints;
+    view->cardsFacedUp = game->cardsFacedUp;
+    memcpy(view->tokens, game->tokens, sizeof(game->tokens));
+    memcpy(view->cards, game->cards, sizeof(game->cards));
+    for (int i = 0; i < game->numPlayers; i++) {
+        Player* player = &game->players[i];
+        view->players[i].totalPoints = player->totalPoints;
+        memcpy(view->players[i].discounts, player->discounts,
+                sizeof(player->discounts));
+        memcpy(view->players[i].tokens, player->tokens,
+                sizeof(player->tokens));
+    }
+
+    // The callback is per thread, but shared by players of the same plugin
+    move->type = MOVE_NONE;
+    plugin->set_move_callback(store_move, move);
+    plugin->choose_move(view);
+}
+
+/*
+ * Checks whether a move is legal for a player to make.
+ *
+ * @param game The game struct
+ * @param playerId The player making the move
+ * @param move Move the player chose
+ * @return true if the move is legal, false otherwise
+ */
+bool is_legal_move(Game* game, int playerId, PlayerMove* move) {
+    switch (move->type) {
+        case MOVE_WILD:
+            return true;
+        case MOVE_TAKE:
+            return is_valid_token_take(game, move->tokens);
+        case MOVE_PURCHASE:
+            return move->cardId >= 0 && move->cardId < game->cardsFacedUp
+                    && can_tokens_buy_card(game, playerId, move->cardId,
+                    move->tokens);
+        default:
+            return false;
+    }
+}
+
+/*
+ * Reads a whole file into memory. Regular files are mapped with mmap.
+ * Anything else (such as a pipe), or files that can't be mapped, is read
+ * into a malloc'ed buffer.
+ *
+ * @param fd File descriptor of the file to read
+ * @param size Set to the number of bytes in the file
+ * @param mapped Set to whether the contents were mapped (to be released
+ *        with munmap) rather than malloc'ed (to be released with free)
+ * @return Contents of the file, or NULL if it is empty or can't be read
+ */
+char* read_whole_file(int fd, size_t* size, bool* mapped) {
+    struct stat info;
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode)
+            && info.st_size > 0) {
+        char* contents = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE,
+                fd, 0);
+        if (contents != MAP_FAILED) {
+            *size = info.st_size;
+            *mapped = true;
+            return contents;
+        }
+    }
+
+    size_t capacity = 0;
+    char* contents = NULL;
+    ssize_t numRead;
+    *size = 0;
+    *mapped = false;
+    do {
+        if (*size == capacity) {
+            capacity = capacity * 2 + 4096;
+            contents = realloc(contents, capacity);
+        }
+        numRead = read(fd, contents + *size, capacity - *size);
+        *size += (numRead > 0) ? numRead : 0;
+    } while (numRead > 0);
+
+    if (*size == 0) {
+        free(contents);
+        return NULL;
+    }
+    return contents;
+}
+
+/*
+ * Reads a deckfile number of at most 9 digits, so it can't overflow.
+ *
+ * @param input Where to read from. Moved past the number read.
+ * @param end End of input
+ * @param number Destination for number read
+ * @return true if a number was read, false if there were no digits or
+ *         too many
+ */
+bool read_plain_number(const char** input, const char* end, int* number) {
+    const char* start = *input;
+    *number = 0;
+    while (*input < end && **input >= '0' && **input <= '9'
+            && *input - start < 9) {
+        *number = *number * 10 + (**input - '0');
+        (*input)++;
+    }
+    return *input > start && (*input == end || **input < '0'
+            || **input > '9');
+}
+
+/*
+ * Reads a card from a deckfile line of the plainest form, D:V:P,B,Y,R with
+ * unsigned numbers and nothing after them, without going through sscanf.
+ * create_card reads any such line the same way. Lines with anything else
+ * (signs, whitespace, trailing characters) are left for create_card to
+ * decide on.
+ *
+ * @param line Line to read, without its newline
+ * @param length Length of line
+ * @param card Destination for card read
+ * @return true if the line was of the plainest form, false otherwise
+ */
+bool read_plain_card(const char* line, int length, Card* card) {
+    const char* end = line + length;
+    const char separators[] = ":,,,";
+
+    if (length < 2 || line[1] != ':'
+            || (card->discount = get_card_colour(line[0])) == INVALID_COLOUR) {
+        return false;
+    }
+
+    line += 2;
+    if (!read_plain_number(&line, end, &card->value)) {
+        return false;
+    }
+    for (int colour = 0; colour < NUM_COLOURS; colour++) {
+        if (line == end || *line++ != separators[colour]
+                || !read_plain_number(&line, end, &card->price[colour])) {
+            return false;
+        }
+    }
+    return line == end;
+}
+
+/*
+ * Packs a card to be stored in a binary deck.
+ *
+ * @param card Card to pack
+ * @param packed Destination to store packed card in
+ * @return true if packed, false if the card's value or a price is outside
+ *         0 to 255
+ */
+bool pack_card(Card card, PackedCard* packed) {
+    if (card.value < 0 || card.value > UINT8_MAX) {
+        return false;
+    }
+    packed->discount = card.discount;
+    packed->value = card.value;
+    for (int i = 0; i < NUM_COLOURS; i++) {
+        if (card.price[i] < 0 || card.price[i] > UINT8_MAX) {
+            return false;
+        }
+        packed->price[i] = card.price[i];
+    }
+    return true;
+}
+
+/*
+ * Unpacks a card stored in a binary deck.
+ *
+ * @param packed Card to unpack
+ * @return The unpacked card
+ */
+Card unpack_card(const PackedCard* packed) {
+    Card card = {.discount = packed->discount, .value = packed->value};
+    for (int i = 0; i < NUM_COLOURS; i++) {
+        card.price[i] = packed->price[i];
+    }
+    return card;
+}
+
+/*
+ * Checks whether a deck path names a binary deck, by its suffix.
+ *
+ * @param filename Path to deck
+ * @return true if filename ends in PACKED_DECK_SUFFIX
+ */
+bool is_packed_deck_path(char* filename) {
+    size_t length = strlen(filename);
+    size_t suffixLength = strlen(PACKED_DECK_SUFFIX);
+    return length > suffixLength && strcmp(filename + length - suffixLength,
+            PACKED_DECK_SUFFIX) == 0;
+}
+
+/*
+ * Maps a binary deck written by deckc into memory. The cards are used
+ * where they are, so every process using the same deck shares its pages.
+ * Only the discount colours are checked, as they are used as indexes.
+ *
+ * @param filename Path to binary deck
+ * @param cards Set to the mapped cards, to be given to unmap_packed_deck
+ * @return Number of cards in the deck, DECK_UNREADABLE if the file can't
+ *         be opened, or DECK_INVALID if it isn't a valid binary deck
+ */
+int map_packed_deck(char* filename, const PackedCard** cards) {
+    int fd = open(filename, O_RDONLY);
+    if (fd == -1) {
+        return DECK_UNREADABLE;
+    }
+
+    struct stat info;
+    PackedDeckHeader* header = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode)
+            && info.st_size > sizeof(PackedDeckHeader)) {
+        header = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    *cards = NULL;
+    if (header == MAP_FAILED) {
+        return DECK_INVALID;
+    }
+
+    // The file must hold exactly the cards its header says it does
+    const PackedCard* packed = (const PackedCard*) (header + 1);
+    int numCards = header->numCards;
+    bool valid = memcmp(header->magic, PACKED_DECK_MAGIC,
+            sizeof(header->magic)) == 0 && header->numCards <= INT32_MAX
+            && info.st_size == sizeof(PackedDeckHeader)
+            + (off_t) header->numCards * sizeof(PackedCard);
+    for (int i = 0; valid && i < numCards; i++) {
+        valid = packed[i].discount < NUM_COLOURS;
+    }
+
+    if (!valid) {
+        munmap(header, info.st_size);
+        return DECK_INVALID;
+    }
+    *cards = packed;
+    return numCards;
+}
+
+/*
+ * Unmaps a binary deck mapped by map_packed_deck.
+ *
+ * @param cards Cards of the deck
+ * @param numCards Number of cards in the deck
+ */
+void unmap_packed_deck(const PackedCard* cards, int numCards) {
+    const PackedDeckHeader* header = (const PackedDeckHeader*) cards - 1;
+    munmap((void*) header,
+            sizeof(PackedDeckHeader) + numCards * sizeof(PackedCard));
+}
+
+/*
+ * Reads every card in a binary deck (see map_packed_deck) into an array.
+ *
+ * @param filename Path to binary deck
+ * @param cards Set to malloc'ed array of cards read
+ * @return Number of cards read, DECK_UNREADABLE if the file can't be
+ *         opened, or DECK_INVALID if it isn't a valid binary deck
+ */
+int read_packed_deck_cards(char* filename, Card** cards) {
+    const PackedCard* packed;
+    int numCards = map_packed_deck(filename, &packed);
+    *cards = NULL;
+    if (numCards < 0) {
+        return numCards;
+    }
+
+    *cards = malloc(sizeof(Card) * numCards);
+    for (int i = 0; i < numCards; i++) {
+        (*cards)[i] = unpack_card(&packed[i]);
+    }
+    unmap_packed_deck(packed, numCards);
+    return numCards;
+}
+
+/*
+ * Reads every card in a deckfile, in order.
+ * Each line of deckfile is formatted as D:V:P,B,Y,R, where D is the
+ * discount colour, V is the value, and P, B, Y, R are the prices in tokens
+ * for Purple, Brown, Yellow, Red respectively. The last line can either
+ * have a newline or just EOF.
+ * The file is read in one pass over its mapped contents (see
+ * read_whole_file). Lines are split the same way get_input would split
+ * them, and anything but the plainest lines is checked with create_card.
+ * Binary decks (see is_packed_deck_path) are read as well.
+ *
+ * @param filename Path to deckfile
+ * @param cards Set to malloc'ed array of cards read
+ * @return Number of cards read, DECK_UNREADABLE if the file can't be
+ *         opened, or DECK_INVALID if it is incorrectly formatted or empty
+ */
+int read_deck_cards(char* filename, Card** cards) {
+    if (is_packed_deck_path(filename)) {
+        return read_packed_deck_cards(filename, cards);
+    }
+
+    int fd = open(filename, O_RDONLY);
+    if (fd == -1) {
+        return DECK_UNREADABLE;
+    }
+
+    size_t size;
+    bool mapped;
+    char* contents = read_whole_file(fd, &size, &mapped);
+    close(fd);
+    *cards = NULL;
+    if (contents == NULL) {
+        return DECK_INVALID;
+    }
+
+    // Usually every card is on its own line. Lines too long for one
+    // get_input are split into more cards though, so room may run out.
+    size_t maxCards = 1;
+    for (char* c = contents; (c = memchr(c, '\n', contents + size - c));
+            c++) {
+        maxCards++;
+    }
+    *cards = malloc(sizeof(Card) * maxCards);
+
+    int numCards = 0;
+    char* line = contents;
+    char* end = contents + size;
+    while (line < end) {
+        // Take a line as get_input would, at most BUFFER_SIZE - 1 bytes
+        size_t maxLength = (end - line < BUFFER_SIZE - 1)
+                ? end - line : BUFFER_SIZE - 1;
+        char* newline = memchr(line, '\n', maxLength);
+        int length = (newline == NULL) ? maxLength : newline - line;
+        char* next = line + length + (newline != NULL);
+
+        Card card;
+        bool valid = read_plain_card(line, length, &card);
+        if (!valid) {
+            char lineBuffer[BUFFER_SIZE];
+            memcpy(lineBuffer, line, length);
+            lineBuffer[length] = '\0';
+
+            // Handle deckfile ending in newline
+            if (strlen(lineBuffer) == 0 && next == end) {
+                // If deckfile ends in newline, then EOF must be next
+                break;
+            }
+            valid = strlen(lineBuffer) > 0 && create_card(lineBuffer, &card)
+                    && !has_any_whitespace(lineBuffer);
+        }
+        if (!valid) {
+            numCards = DECK_INVALID;
+            break;
+        }
+
+        if (numCards == maxCards) {
+            maxCards *= 2;
+            *cards = realloc(*cards, sizeof(Card) * maxCards);
+        }
+        (*cards)[numCards++] = card;
+        line = next;
+    }
+
+    if (mapped) {
+        munmap(contents, size);
+    } else {
+        free(contents);
+    }
+    if (numCards <= 0) {
+        free(*cards);
+        *cards = NULL;
+        return DECK_INVALID;
+    }
+    return numCards;
+}
+
+/*
+ * Scrambles the bits of a number (splitmix64's finaliser).
+ *
+ * @param value Number to scramble
+ * @return Scrambled number
+ */
+unsigned long long mix_bits(unsigned long long value) {
+    value += SHUFFLE_STATE_STEP;
+    value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+    return value ^ (value >> 31);
+}
+
+/*
+ * Shuffles the order a deck is dealt in for one game. The seed and game
+ * number are both mixed into the generator's starting state, and the
+ * state steps by splitmix64's constant, so every game gets an unrelated
+ * shuffle. The same seed and game always give the same order.
+ *
+ * @param order Destination for the order, deckSize indexes into the deck
+ * @param deckSize Number of cards in the deck
+ * @param seed Seed of every game's shuffle
+ * @param gameNumber Game the order is for
+ */
+void shuffle_deck_order(int* order, int deckSize, unsigned long long seed,
+        long gameNumber) {
+    unsigned long long state = mix_bits(mix_bits(seed) + gameNumber);
+
+    for (int i = 0; i < deckSize; i++) {
+        order[i] = i;
+    }
+    for (int i = deckSize - 1; i > 0; i--) {
+        state += SHUFFLE_STATE_STEP;
+        int j = mix_bits(state) % (i + 1);
+        int swap = order[i];
+        order[i] = order[j];
+        order[j] = swap;
+    }
+}
+
+/*
+ * Makes a legal move for a player, drawing a new card if one was bought.
+ *
+ * @param game The game struct
+ * @param playerId The player making the move
+ * @param move Legal move the player chose
+ * @param deck Cards in the order they are drawn
+ * @param deckSize Number of cards in deck
+ * @param nextCard Index of the next card to draw, updated
+ */
+void make_move(Game* game, int playerId, PlayerMove* move, Card* deck,
+        int deckSize, int* nextCard) {
+    if (move->type == MOVE_WILD) {
+        player_took_wild(game, playerId);
+    } else if (move->type == MOVE_TAKE) {
+        player_took_tokens(game, playerId, move->tokens);
+    } else {
+        player_purchased_card(game, playerId, move->cardId, move->tokens);
+        if (*nextCard < deckSize) {
+            add_card_to_board(game, deck[(*nextCard)++]);
+        }
+    }
+}
+
+/*
+ * Plays a whole game between plugin players, with the same rules as the
+ * hub but without printing anything or starting any processes.
+ * Safe to call from several threads at once.
+ *
+ * @param seats Player implementation playing each seat
+ * @param numPlayers The number of players in the game
+ * @param initialTokens The initial number of tokens on board piles
+ * @param maxPoints The number of points a player needs to win
+ * @param deck Cards in the order they are drawn
+ * @param deckSize Number of cards in deck
+ * @param result Destination to store how the game went
+ */
+void play_plugin_game(PlayerPlugin** seats, int numPlayers,
+        int initialTokens, int maxPoints, Card* deck, int deckSize,
+        MatchResult* result) {
+    Game* game = setup_game(numPlayers);
+    Game* views[numPlayers];
+    for (int i = 0; i < numPlayers; i++) {
+        views[i] = setup_game(numPlayers);
+        views[i]->myId = i;
+    }
+
+    game->maxPoints = maxPoints;
+    set_initial_game_tokens(game, initialTokens);
+    int nextCard = 0;
+    while (nextCard < deckSize && nextCard < MAX_CARDS_ON_BOARD) {
+        add_card_to_board(game, deck[nextCard++]);
+    }
+
+    result->rounds = 0;
+    result->finished = true;
+    result->badPlayer = -1;
+    bool gameOver = false;
+    while (!gameOver && result->badPlayer == -1) {
+        if (++result->rounds > MATCH_MAX_ROUNDS) {
+            result->finished = false;
+            break;
+        }
+
+        for (int curPlayer = 0; curPlayer < numPlayers; curPlayer++) {
+            // Player gets two attempts to give a valid move.
+            PlayerMove move;
+            ask_player_plugin(seats[curPlayer], game, views[curPlayer],
+                    &move);
+            if (!is_legal_move(game, curPlayer, &move)) {
+                ask_player_plugin(seats[curPlayer], game, views[curPlayer],
+                        &move);
+            }
+            if (!is_legal_move(game, curPlayer, &move)) {
+                result->badPlayer = curPlayer;
+                break;
+            }
+            make_move(game, curPlayer, &move, deck, deckSize, &nextCard);
+
+            // Game ends after this round once max points is reached,
+            // or immediately if no cards are left
+            gameOver = gameOver || is_game_over(game);
+            if (game->cardsFacedUp == 0) {
+                gameOver = true;
+                break;
+            }
+        }
+    }
+
+    int highestScore = 0;
+    for (int i = 0; i < numPlayers; i++) {
+        result->points[i] = game->players[i].totalPoints;
+        if (result->points[i] > highestScore) {
+            highestScore = result->points[i];
+        }
+    }
+    for (int i = 0; i < numPlayers; i++) {
+        result->winners[i] = result->points[i] == highestScore;
+    }
+
+    for (int i = 0; i < numPlayers; i++) {
+        free_game(views[i]);
+    }
+    free_game(game);
+}
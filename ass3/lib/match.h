@@ -0,0 +1,98 @@
+#include "game.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifndef MATCH_H
+#define MATCH_H
+
+/* Errors returned by read_deck_cards */
+#define DECK_UNREADABLE -1
+#define DECK_INVALID -2
+
+/* Binary decks written by deckc start with this, and are named *.deckb */
+#define PACKED_DECK_MAGIC "ADK1"
+#define PACKED_DECK_SUFFIX ".deckb"
+
+/* Rounds after which play_plugin_game gives up on a game */
+#define MATCH_MAX_ROUNDS 100000
+
+/*
+ * A player implementation loaded with dlopen, shared by every player
+ * (and thread) that uses it.
+ * - handle: Handle returned by dlopen
+ * - choose_move: The player implementation's choose_move
+ * - set_move_callback: Sets where the player implementation's moves go
+ */
+typedef struct {
+    void* handle;
+    void (*choose_move)(Game*);
+    void (*set_move_callback)(MoveCallback, void*);
+} PlayerPlugin;
+
+/*
+ * Outcome of a game played by play_plugin_game.
+ * - rounds: Number of rounds started
+ * - finished: false if the game was given up on after MATCH_MAX_ROUNDS
+ * - badPlayer: Player who made two illegal moves in a row, or -1
+ * - points: Points each player finished with
+ * - winners: Whether each player finished with the most points
+ */
+typedef struct {
+    int rounds;
+    bool finished;
+    int badPlayer;
+    int points[MAX_PLAYERS];
+    bool winners[MAX_PLAYERS];
+} MatchResult;
+
+/*
+ * Start of a binary deck, followed by numCards PackedCards. Numbers are in
+ * the byte order of the machine that wrote the deck.
+ * - magic: PACKED_DECK_MAGIC, without its terminating null
+ * - numCards: Number of cards in the deck
+ */
+typedef struct {
+    char magic[4];
+    uint32_t numCards;
+} PackedDeckHeader;
+
+/*
+ * A card as stored in a binary deck. Only cards whose value and prices
+ * are all 0 to 255 can be packed.
+ * - discount: The CardColour of the card's discount
+ * - value: The number of points the card is worth
+ * - price: The price in tokens for each colour
+ */
+typedef struct {
+    uint8_t discount;
+    uint8_t value;
+    uint8_t price[NUM_COLOURS];
+} PackedCard;
+
+bool open_player_plugin(char* path, PlayerPlugin* plugin);
+void close_player_plugin(PlayerPlugin* plugin);
+
+void ask_player_plugin(PlayerPlugin* plugin, Game* game, Game* view,
+        PlayerMove* move);
+
+bool is_legal_move(Game* game, int playerId, PlayerMove* move);
+
+bool pack_card(Card card, PackedCard* packed);
+Card unpack_card(const PackedCard* packed);
+
+bool is_packed_deck_path(char* filename);
+int map_packed_deck(char* filename, const PackedCard** cards);
+void unmap_packed_deck(const PackedCard* cards, int numCards);
+
+int read_deck_cards(char* filename, Card** cards);
+
+unsigned long long mix_bits(unsigned long long value);
+void shuffle_deck_order(int* order, int deckSize, unsigned long long seed,
+        long gameNumber);
+
+void play_plugin_game(PlayerPlugin** seats, int numPlayers,
+        int initialTokens, int maxPoints, Card* deck, int deckSize,
+        MatchResult* result);
+
+#endif
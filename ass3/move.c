@@ -0,0 +1,77 @@
+#include "player.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// Callback moves are sent to instead of stdout, if set. Per thread, so
+// threads can play different games with the same plugin at once.
+__thread MoveCallback moveCallback = NULL;
+// Data passed along to moveCallback
+__thread void* moveCallbackData = NULL;
+
+/*
+ * Sends moves to the given callback instead of printing them to stdout.
+ * Lets a player loaded into the hub as a plugin give the hub its moves
+ * without any messages being sent.
+ *
+ * @param callback Function to call with each move, or NULL to use stdout
+ * @param data Data passed to callback along with each move
+ */
+void set_move_callback(MoveCallback callback, void* data) {
+    moveCallback = callback;
+    moveCallbackData = data;
+}
+
+/*
+ * Tells hub the player wishes to take a wild by printing "wild" to stdout.
+ */
+void tell_hub_take_wild(void) {
+    if (moveCallback != NULL) {
+        PlayerMove move = {.type = MOVE_WILD};
+        moveCallback(&move, moveCallbackData);
+        return;
+    }
+
+    printf("wild\n");
+    fflush(stdout);
+}
+
+/*
+ * Tells hub the player wishes to take tokens by printing
+ * a "take" command to stdout.
+ *
+ * @param tokens The tokens the player wishes to take from the board
+ */
+void tell_hub_take_tokens(int tokens[NUM_COLOURS]) {
+    if (moveCallback != NULL) {
+        PlayerMove move = {.type = MOVE_TAKE};
+        memcpy(move.tokens, tokens, sizeof(int) * NUM_COLOURS);
+        moveCallback(&move, moveCallbackData);
+        return;
+    }
+
+    printf("take%d,%d,%d,%d\n",
+            tokens[PURPLE], tokens[BROWN], tokens[YELLOW], tokens[RED]);
+    fflush(stdout);
+}
+
+/*
+ * Tells hub the player wishes to purchase a face up card by
+ * printing a "purchase" command to stdout.
+ *
+ * @param cardId Id (0-7) of card to purchase
+ * @param tokens Tokens being used to buy card
+ */
+void tell_hub_purchase_card(int cardId, int tokens[TOKEN_SLOTS]) {
+    if (moveCallback != NULL) {
+        PlayerMove move = {.type = MOVE_PURCHASE, .cardId = cardId};
+        memcpy(move.tokens, tokens, sizeof(int) * TOKEN_SLOTS);
+        moveCallback(&move, moveCallbackData);
+        return;
+    }
+
+    printf("purchase%d:%d,%d,%d,%d,%d\n", cardId,
+            tokens[PURPLE], tokens[BROWN], tokens[YELLOW], tokens[RED],
+            tokens[WILD]);
+    fflush(stdout);
+}
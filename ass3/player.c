@@ -51,42 +51,6 @@ void exit_player(Game* game, Result code) {
     exit(code);
 }
 
-/*
- * Tells hub the player wishes to take a wild by printing "wild" to stdout.
- *
- * @param game The game struct
- */
-void tell_hub_take_wild(void) {
-    printf("wild\n");
-    fflush(stdout);
-}
-
-/*
- * Tells hub the player wishes to take tokens by printing
- * a "take" command to stdout.
- *
- * @param tokens The tokens the player wishes to take from the board
- */
-void tell_hub_take_tokens(int tokens[NUM_COLOURS]) {
-    printf("take%d,%d,%d,%d\n",
-            tokens[PURPLE], tokens[BROWN], tokens[YELLOW], tokens[RED]);
-    fflush(stdout);
-}
-
-/*
- * Tells hub the player wishes to purchase a face up card by
- * printing a "purchase" command to stdout.
- *
- * @param cardId Id (0-7) of card to purchase
- * @param tokens Tokens being used to buy card
- */
-void tell_hub_purchase_card(int cardId, int tokens[TOKEN_SLOTS]) {
-    printf("purchase%d:%d,%d,%d,%d,%d\n", cardId,
-            tokens[PURPLE], tokens[BROWN], tokens[YELLOW], tokens[RED],
-            tokens[WILD]);
-    fflush(stdout);
-}
-
 /*
  * Prints status of game to stderr.
  * Lists cards in the market and their details.
@@ -269,6 +233,33 @@ Result handle_end_of_game(Game* game) {
     return END_OF_GAME;
 }
 
+/*
+ * Handles a "newgame" message from the hub. The hub sends this, instead of
+ * "eog", to keep the player on for another game once theirs is over.
+ * Data is of format " pcount myid", as in the player's arguments.
+ * Message is invalid if the player count or id is invalid.
+ *
+ * @param game The game struct, replaced with a new game on success
+ * @param data The message data associated with the command from hub
+ * @return Result: NORMAL for success, COMMUNICATION_ERROR if message invalid.
+ */
+Result handle_new_game(Game** game, char* data) {
+    int numPlayers, playerId, length = 0;
+    int result = sscanf(data, " %d %d%n", &numPlayers, &playerId, &length);
+
+    // Check input is valid, the same as the player's arguments
+    if (result != 2 || data[length] != '\0' || numPlayers < 2
+            || numPlayers > MAX_PLAYERS || playerId < 0
+            || playerId > numPlayers - 1) {
+        return COMMUNICATION_ERROR;
+    }
+
+    free_game(*game);
+    *game = setup_game(numPlayers);
+    (*game)->myId = playerId;
+    return NORMAL;
+}
+
 /*
  * Handles a "dowhat" message from the hub.
  * Prints "received dowhat" to stderr, and runs the choose_move function,
@@ -317,14 +308,14 @@ Result handle_input(Game* game, char* input) {
 /*
  * Runs the main loop of the player process.
  * Takes input from stdin and parses/handles each line until
- * stdin is closed.
+ * stdin is closed. A "newgame" message starts tracking a new game.
  *
- * @param game The game struct
+ * @param game The game struct, replaced by each new game
  * @return Final result of loop. COMMUNICATION_ERROR is a message inputted
  *         was invalid, or EOF was reached before a game over.
  *         END_OF_GAME if game ended normally.
  */
-Result run_game_loop(Game* game) {
+Result run_game_loop(Game** game) {
     char inputBuffer[BUFFER_SIZE];
 
     while (true) {
@@ -332,7 +323,12 @@ Result run_game_loop(Game* game) {
             return COMMUNICATION_ERROR;
         }
 
-        Result res = handle_input(game, inputBuffer);
+        Result res;
+        if (starts_with(inputBuffer, "newgame")) {
+            res = handle_new_game(game, inputBuffer + strlen("newgame"));
+        } else {
+            res = handle_input(*game, inputBuffer);
+        }
 
         if (res != NORMAL) {
             return res;
@@ -369,7 +365,7 @@ int main(int argc, char** argv) {
     Game* game = setup_game(numPlayers);
     game->myId = playerId;
 
-    Result result = run_game_loop(game);
+    Result result = run_game_loop(&game);
 
     // We get here when game is over, either normally or due to error
     exit_player(game, result);
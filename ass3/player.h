@@ -7,7 +7,11 @@
  * Shared interface methods between base player and specific implementations
  */
 
-/* Implemented by base player */
+/* Implemented by base player (move.c) */
+
+// Sends moves to the given callback instead of telling hub on stdout.
+// Used when the player is loaded into the hub as a plugin.
+void set_move_callback(MoveCallback callback, void* data);
 
 // Tells hub to take a wild token
 void tell_hub_take_wild(void);
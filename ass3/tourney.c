@@ -0,0 +1,348 @@
+#include "lib/util.h"
+#include "lib/game.h"
+#include "lib/match.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+
+/* Final points and game lengths past these are counted in the last bucket */
+#define POINT_BUCKETS 32
+#define LENGTH_BUCKETS 128
+
+/*
+ * Represents a result/exit code from the tournament runner
+ */
+typedef enum {
+    NORMAL = 0,
+    WRONG_NUM_ARGS = 1,
+    INVALID_ARGS = 2,
+    DECKFILE_UNREADABLE = 3,
+    DECKFILE_INCORRECT = 4,
+    PLAYER_START_FAIL = 5
+} Result;
+
+/*
+ * Results of the games one worker thread played.
+ * - games: Number of games played
+ * - unfinished: Games given up on after MATCH_MAX_ROUNDS rounds
+ * - protocolErrors: Games ended by a player making two illegal moves
+ * - wins: Games each seat finished with the most points (including ties)
+ * - soleWins: Games each seat finished with the most points alone
+ * - totalPoints: Sum of points each seat finished with
+ * - points: Number of games each seat finished with each number of points
+ * - totalRounds: Sum of rounds played in every game
+ * - lengths: Number of games that lasted each number of rounds
+ */
+typedef struct {
+    long games;
+    long unfinished;
+    long protocolErrors;
+    long wins[MAX_PLAYERS];
+    long soleWins[MAX_PLAYERS];
+    long totalPoints[MAX_PLAYERS];
+    long points[MAX_PLAYERS][POINT_BUCKETS];
+    long totalRounds;
+    long lengths[LENGTH_BUCKETS];
+} TourneyStats;
+
+/*
+ * Settings of a tournament, shared by every worker thread.
+ * - initialTokens: The initial number of tokens on board piles
+ * - maxPoints: The number of points a player needs to win
+ * - numPlayers: Number of seats in each game
+ * - seats: Player implementation playing each seat
+ * - deck: Cards in deckfile order, shuffled differently for each game
+ * - deckSize: Number of cards in deck
+ * - numGames: Number of games to play
+ * - seed: Seed of every game's shuffle
+ * - nextGame: Next game for a worker to take
+ */
+typedef struct {
+    int initialTokens;
+    int maxPoints;
+    int numPlayers;
+    PlayerPlugin** seats;
+    Card* deck;
+    int deckSize;
+    long numGames;
+    unsigned long long seed;
+    long nextGame;
+} Tourney;
+
+/*
+ * A worker thread and its own results, merged once every game is played.
+ * - tourney: Tournament being played
+ * - stats: Results of the games this worker played
+ */
+typedef struct {
+    Tourney* tourney;
+    TourneyStats stats;
+} Worker;
+
+/*
+ * Exits with given code, printing why to stderr.
+ *
+ * @param code Exit reason
+ */
+void exit_tourney(Result code) {
+    switch (code) {
+        case WRONG_NUM_ARGS:
+            fprintf(stderr, "Usage: austerity-tourney [--threads n] "
+                    "[--seed n] tokens points deck games player.so "
+                    "player.so [player.so ...]\n");
+            break;
+        case INVALID_ARGS:
+            fprintf(stderr, "Bad argument\n");
+            break;
+        case DECKFILE_UNREADABLE:
+            fprintf(stderr, "Cannot access deck file\n");
+            break;
+        case DECKFILE_INCORRECT:
+            fprintf(stderr, "Invalid deck file contents\n");
+            break;
+        case PLAYER_START_FAIL:
+            fprintf(stderr, "Bad start\n");
+            break;
+        default:
+            break;
+    }
+
+    exit(code);
+}
+
+/*
+ * Shuffles the deck for one game (see shuffle_deck_order). The same seed
+ * and game always give the same order, however games are shared between
+ * threads.
+ *
+ * @param tourney Tournament settings
+ * @param gameNumber Game the deck is for
+ * @param order Space for the deck's order, tourney->deckSize indexes
+ * @param deck Destination for the shuffled deck, tourney->deckSize cards
+ */
+void shuffle_deck(Tourney* tourney, long gameNumber, int* order,
+        Card* deck) {
+    shuffle_deck_order(order, tourney->deckSize, tourney->seed, gameNumber);
+    for (int i = 0; i < tourney->deckSize; i++) {
+        deck[i] = tourney->deck[order[i]];
+    }
+}
+
+/*
+ * Adds a game's result to a worker's results.
+ *
+ * @param stats Worker's results
+ * @param result Result of the game
+ * @param numPlayers Number of seats in the game
+ */
+void record_result(TourneyStats* stats, MatchResult* result,
+        int numPlayers) {
+    stats->games++;
+    stats->unfinished += !result->finished;
+    stats->protocolErrors += (result->badPlayer != -1);
+    stats->totalRounds += result->rounds;
+    stats->lengths[(result->rounds < LENGTH_BUCKETS)
+            ? result->rounds : LENGTH_BUCKETS - 1]++;
+
+    int numWinners = 0;
+    for (int i = 0; i < numPlayers; i++) {
+        numWinners += result->winners[i];
+    }
+    for (int i = 0; i < numPlayers; i++) {
+        int points = result->points[i];
+        stats->wins[i] += result->winners[i];
+        stats->soleWins[i] += result->winners[i] && numWinners == 1;
+        stats->totalPoints[i] += points;
+        stats->points[i][(points < POINT_BUCKETS)
+                ? points : POINT_BUCKETS - 1]++;
+    }
+}
+
+/*
+ * Adds one worker's results to another's.
+ *
+ * @param dest Results to add to
+ * @param src Results to add
+ */
+void merge_results(TourneyStats* dest, TourneyStats* src) {
+    dest->games += src->games;
+    dest->unfinished += src->unfinished;
+    dest->protocolErrors += src->protocolErrors;
+    dest->totalRounds += src->totalRounds;
+    for (int i = 0; i < LENGTH_BUCKETS; i++) {
+        dest->lengths[i] += src->lengths[i];
+    }
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+        dest->wins[i] += src->wins[i];
+        dest->soleWins[i] += src->soleWins[i];
+        dest->totalPoints[i] += src->totalPoints[i];
+        for (int j = 0; j < POINT_BUCKETS; j++) {
+            dest->points[i][j] += src->points[i][j];
+        }
+    }
+}
+
+/*
+ * Takes games off the tournament's queue and plays them until there are
+ * none left, recording results in the worker's own counters.
+ *
+ * @param arg Worker for this thread
+ * @return NULL
+ */
+void* run_worker(void* arg) {
+    Worker* worker = (Worker*) arg;
+    Tourney* tourney = worker->tourney;
+    Card* deck = malloc(sizeof(Card) * tourney->deckSize);
+    int* order = malloc(sizeof(int) * tourney->deckSize);
+
+    while (true) {
+        long gameNumber = __atomic_fetch_add(&tourney->nextGame, 1,
+                __ATOMIC_RELAXED);
+        if (gameNumber >= tourney->numGames) {
+            break;
+        }
+
+        MatchResult result;
+        shuffle_deck(tourney, gameNumber, order, deck);
+        play_plugin_game(tourney->seats, tourney->numPlayers,
+                tourney->initialTokens, tourney->maxPoints, deck,
+                tourney->deckSize, &result);
+        record_result(&worker->stats, &result, tourney->numPlayers);
+    }
+
+    free(order);
+    free(deck);
+    return NULL;
+}
+
+/*
+ * Prints the tournament's results: each seat's wins and points, and how
+ * long games lasted. Distributions only list counts that aren't zero.
+ *
+ * @param stats Results of every game
+ * @param numPlayers Number of seats
+ * @param names Path of the player in each seat
+ * @param seconds Time the games took to play
+ */
+void print_results(TourneyStats* stats, int numPlayers, char** names,
+        double seconds) {
+    printf("Played %ld games in %.3f s (%.0f games/s)\n", stats->games,
+            seconds, stats->games / seconds);
+    if (stats->unfinished > 0 || stats->protocolErrors > 0) {
+        printf("%ld unfinished, %ld protocol errors\n", stats->unfinished,
+                stats->protocolErrors);
+    }
+
+    for (int i = 0; i < numPlayers; i++) {
+        printf("Player %c %s: won %ld (%.1f%%), alone %ld, "
+                "mean points %.2f\n", player_int_to_char(i), names[i],
+                stats->wins[i], 100.0 * stats->wins[i] / stats->games,
+                stats->soleWins[i],
+                (double) stats->totalPoints[i] / stats->games);
+    }
+    for (int i = 0; i < numPlayers; i++) {
+        printf("Player %c points:", player_int_to_char(i));
+        for (int j = 0; j < POINT_BUCKETS; j++) {
+            if (stats->points[i][j] > 0) {
+                printf(" %d%s=%ld", j, (j == POINT_BUCKETS - 1) ? "+" : "",
+                        stats->points[i][j]);
+            }
+        }
+        printf("\n");
+    }
+
+    printf("Rounds: mean %.2f,", (double) stats->totalRounds / stats->games);
+    for (int i = 0; i < LENGTH_BUCKETS; i++) {
+        if (stats->lengths[i] > 0) {
+            printf(" %d%s=%ld", i, (i == LENGTH_BUCKETS - 1) ? "+" : "",
+                    stats->lengths[i]);
+        }
+    }
+    printf("\n");
+}
+
+int main(int argc, char** argv) {
+    int numThreads = sysconf(_SC_NPROCESSORS_ONLN), seed = 0;
+
+    // Parse options, which come before other arguments
+    int arg = 1;
+    while (arg + 1 < argc && starts_with(argv[arg], "--")) {
+        if (strcmp(argv[arg], "--threads") == 0) {
+            if (!str_to_int(argv[arg + 1], &numThreads) || numThreads < 1) {
+                exit_tourney(INVALID_ARGS);
+            }
+        } else if (strcmp(argv[arg], "--seed") == 0) {
+            if (!str_to_int(argv[arg + 1], &seed)) {
+                exit_tourney(INVALID_ARGS);
+            }
+        } else {
+            exit_tourney(WRONG_NUM_ARGS);
+        }
+        arg += 2;
+    }
+    argc -= arg - 1;
+    argv += arg - 1;
+    if (argc < 7 || argc > MAX_PLAYERS + 5) {
+        exit_tourney(WRONG_NUM_ARGS);
+    }
+
+    Tourney tourney = {.numPlayers = argc - 5, .seed = seed};
+    int numGames = 0;
+    if (!str_to_int(argv[1], &tourney.initialTokens)
+            || !str_to_int(argv[2], &tourney.maxPoints)
+            || !str_to_int(argv[4], &numGames)
+            || tourney.initialTokens < 0 || tourney.maxPoints < 0
+            || numGames < 1) {
+        exit_tourney(INVALID_ARGS);
+    }
+    tourney.numGames = numGames;
+
+    tourney.deckSize = read_deck_cards(argv[3], &tourney.deck);
+    if (tourney.deckSize == DECK_UNREADABLE) {
+        exit_tourney(DECKFILE_UNREADABLE);
+    } else if (tourney.deckSize == DECK_INVALID) {
+        exit_tourney(DECKFILE_INCORRECT);
+    }
+
+    // Every seat loads its plugin, even if it's already loaded by another
+    PlayerPlugin plugins[tourney.numPlayers];
+    PlayerPlugin* seats[tourney.numPlayers];
+    for (int i = 0; i < tourney.numPlayers; i++) {
+        if (!open_player_plugin(argv[i + 5], &plugins[i])) {
+            exit_tourney(PLAYER_START_FAIL);
+        }
+        seats[i] = &plugins[i];
+    }
+    tourney.seats = seats;
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    Worker* workers = calloc(numThreads, sizeof(Worker));
+    pthread_t threads[numThreads];
+    for (int i = 0; i < numThreads; i++) {
+        workers[i].tourney = &tourney;
+        pthread_create(&threads[i], NULL, run_worker, &workers[i]);
+    }
+    for (int i = 0; i < numThreads; i++) {
+        pthread_join(threads[i], NULL);
+        if (i > 0) {
+            merge_results(&workers[0].stats, &workers[i].stats);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    print_results(&workers[0].stats, tourney.numPlayers, argv + 5,
+            (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9);
+
+    for (int i = 0; i < tourney.numPlayers; i++) {
+        close_player_plugin(&plugins[i]);
+    }
+    free(workers);
+    free(tourney.deck);
+    return NORMAL;
+}